@@ -0,0 +1,246 @@
+#pragma once
+
+//
+// C++20 coroutine awaitables for SerialProcessor. The rest of the library is C++17, so this header is opt-in and
+// compiles to nothing without coroutine support. Coroutines resume inline on whichever thread decodes the frame: the
+// one calling update(), the receive thread from start(), or a SerialReactor. Nothing here starts threads.
+//
+
+#include "serial_library/serial_library.hpp"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <optional>
+
+namespace serial_library
+{
+    /**
+     * Suspends until the next frame with an id is decoded, and evaluates to its values. When built with a request
+     * frame, the request is sent once the listener is in place, so the response cannot be missed. With a correlation
+     * field, only a frame carrying the value the request went out with completes it.
+     */
+    class FrameAwaiter
+    {
+        public:
+        FrameAwaiter(
+            SerialProcessor& processor,
+            const SerialFrameId& frameId,
+            std::optional<SerialFrameId> requestFrame = std::nullopt,
+            SerialFieldId correlationField = FIELD_NONE)
+         : _processor(processor),
+           _frameId(frameId),
+           _requestFrame(requestFrame),
+           _correlationField(correlationField),
+           _state(std::make_shared<ListenState>()) { }
+
+        FrameAwaiter(const FrameAwaiter&) = delete;
+        FrameAwaiter& operator=(const FrameAwaiter&) = delete;
+
+        ~FrameAwaiter()
+        {
+            //only if the coroutine was destroyed while waiting
+            if(_state->registered && !_state->claimed.exchange(true))
+            {
+                _processor.removeFrameListener(_state->listener);
+            }
+        }
+
+        bool await_ready(void) const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            //once the listener is in place, a receive thread can resume the coroutine and free this awaiter before
+            //this function returns. everything used after that point is copied out first
+            SerialProcessor& processor = _processor;
+            const std::optional<SerialFrameId> requestFrame = _requestFrame;
+            const SerialFieldId correlationField = _correlationField;
+            std::shared_ptr<ListenState> state = _state;
+
+            SerialData correlationValue;
+            if(correlationField != FIELD_NONE)
+            {
+                correlationValue = processor.getField(correlationField).data;
+            }
+
+            state->listener = processor.addFrameListener(_frameId, [this, handle, correlationField, correlationValue, state] (const SerialValuesMap& values) {
+                if(correlationField != FIELD_NONE)
+                {
+                    auto it = values.find(correlationField);
+                    if(it == values.end() ||
+                        it->second.data.numData != correlationValue.numData ||
+                        memcmp(it->second.data.data, correlationValue.data, correlationValue.numData) != 0)
+                    {
+                        return false;
+                    }
+                }
+
+                //whoever claims the awaiter first resumes or cleans up, never both
+                if(state->claimed.exchange(true))
+                {
+                    return true;
+                }
+
+                _values = values;
+                handle.resume();
+                return true;
+            });
+
+            state->registered = true;
+            if(requestFrame)
+            {
+                try
+                {
+                    processor.send(*requestFrame);
+                } catch(...)
+                {
+                    //waits out a call in progress on another thread. if that call already resumed the coroutine, 
+                    //the error has nowhere to go
+                    processor.removeFrameListener(state->listener);
+                    if(!state->claimed.exchange(true))
+                    {
+                        throw;
+                    }
+                }
+            }
+        }
+
+        SerialValuesMap await_resume(void)
+        {
+            return std::move(*_values);
+        }
+
+        private:
+        // shared with the listener, so that it outlives the awaiter
+        struct ListenState
+        {
+            std::atomic<bool> claimed { false };
+            std::atomic<bool> registered { false };
+            uint64_t listener = 0;
+        };
+
+        SerialProcessor& _processor;
+        const SerialFrameId _frameId;
+        const std::optional<SerialFrameId> _requestFrame;
+        const SerialFieldId _correlationField;
+        std::optional<SerialValuesMap> _values;
+        std::shared_ptr<ListenState> _state;
+    };
+
+
+    // co_await nextFrame(processor, id)
+    inline FrameAwaiter nextFrame(SerialProcessor& processor, const SerialFrameId& frameId)
+    {
+        return FrameAwaiter(processor, frameId);
+    }
+
+
+    // co_await request(processor, command, ack): sends the request frame and evaluates to the response's values
+    inline FrameAwaiter request(
+        SerialProcessor& processor,
+        const SerialFrameId& requestFrame,
+        const SerialFrameId& responseFrame,
+        SerialFieldId correlationField = FIELD_NONE)
+    {
+        return FrameAwaiter(processor, responseFrame, requestFrame, correlationField);
+    }
+
+
+    /**
+     * Asynchronous stream of the decoded frames with an id. Frames are queued from the parse path from construction
+     * until destruction, and co_await stream.next() takes the oldest one or suspends until one comes. Past maxQueued
+     * frames, the oldest are dropped.
+     */
+    class FrameStream
+    {
+        public:
+        class NextAwaiter
+        {
+            public:
+            NextAwaiter(FrameStream& stream)
+             : _stream(stream) { }
+
+            bool await_ready(void)
+            {
+                std::lock_guard<std::mutex> guard(_stream._lock);
+                return !_stream._queue.empty();
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                //a frame may have come in since await_ready()
+                std::lock_guard<std::mutex> guard(_stream._lock);
+                if(!_stream._queue.empty())
+                {
+                    return false;
+                }
+
+                _stream._waiter = handle;
+                return true;
+            }
+
+            SerialValuesMap await_resume(void)
+            {
+                std::lock_guard<std::mutex> guard(_stream._lock);
+                SerialValuesMap values = std::move(_stream._queue.front());
+                _stream._queue.pop_front();
+                return values;
+            }
+
+            private:
+            FrameStream& _stream;
+        };
+
+        FrameStream(SerialProcessor& processor, const SerialFrameId& frameId, size_t maxQueued = MAX_PACKET_BATCH)
+         : _processor(processor),
+           _maxQueued(maxQueued)
+        {
+            _listener = _processor.addFrameListener(frameId, [this] (const SerialValuesMap& values) {
+                std::coroutine_handle<> waiter;
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    _queue.push_back(values);
+                    if(_queue.size() > _maxQueued)
+                    {
+                        _queue.pop_front();
+                    }
+
+                    std::swap(waiter, _waiter);
+                }
+
+                if(waiter)
+                {
+                    waiter.resume();
+                }
+
+                return false;
+            });
+        }
+
+        FrameStream(const FrameStream&) = delete;
+        FrameStream& operator=(const FrameStream&) = delete;
+
+        ~FrameStream()
+        {
+            _processor.removeFrameListener(_listener);
+        }
+
+        NextAwaiter next(void)
+        {
+            return NextAwaiter(*this);
+        }
+
+        private:
+        SerialProcessor& _processor;
+        const size_t _maxQueued;
+        uint64_t _listener;
+        std::mutex _lock;
+        std::deque<SerialValuesMap> _queue;
+        std::coroutine_handle<> _waiter;
+    };
+}
+
+#endif
@@ -10,6 +10,9 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <poll.h>
 #endif
 
 //
@@ -17,35 +20,187 @@
 //
 namespace serial_library
 {
+    // os handle that can be waited on for incoming data (a file descriptor on linux)
+    #if defined(USE_WINDOWS)
+    typedef void *NativeHandle;
+    #define INVALID_NATIVE_HANDLE nullptr
+    #else
+    typedef int NativeHandle;
+    #define INVALID_NATIVE_HANDLE -1
+    #endif
+
+    // optional features of a transceiver, reported by SerialTransceiver::capabilities()
+    enum SerialTransceiverCapabilities
+    {
+        TRANSCEIVER_CAP_NONE = 0,
+        TRANSCEIVER_CAP_VECTORED_IO = 1 << 0, // sendv() and recvv() are implemented natively, without an extra copy
+        TRANSCEIVER_CAP_NATIVE_HANDLE = 1 << 1, // nativeHandle() becomes readable when recv() has data
+        TRANSCEIVER_CAP_MESSAGE_BOUNDARIES = 1 << 2 // recv() returns one whole message, and recvPackets() reports where each one is
+    };
+
     class SERLIB_API SerialTransceiver
     {
         public:
         typedef std::shared_ptr<SerialTransceiver> SharedPtr;
         typedef std::unique_ptr<SerialTransceiver> UniquePtr;
 
+        virtual ~SerialTransceiver() = default;
+
         virtual bool init(void) = 0;
         virtual void send(const char *data, size_t numData) = 0;
+        
+        // reads up to numData bytes into data. Implementations must not write to data beyond the returned byte count
         virtual size_t recv(char *data, size_t numData) = 0;
         virtual void deinit(void) = 0;
+
+        // sends the pieces as a single transmission. Default implementation gathers them and calls send()
+        virtual void sendv(const SerialConstIoVec *vecs, size_t numVecs);
+
+        // receives a single transmission into the pieces. Default implementation calls recv() and scatters the result
+        virtual size_t recvv(const SerialIoVec *vecs, size_t numVecs);
+
+        // receives up to maxPackets messages back to back into data, recording where each one is in packets. Returns the 
+        // number of messages. Default implementation calls recv() once and reports the result as one message
+        virtual size_t recvPackets(char *data, size_t numData, SerialPacketInfo *packets, size_t maxPackets);
+
+        // sends each piece as its own message. Default implementation calls send() for each
+        virtual void sendPackets(const SerialConstIoVec *packets, size_t numPackets);
+
+        virtual unsigned int capabilities(void) const;
+
+        // handle that polls readable whenever recv() has data to return, or INVALID_NATIVE_HANDLE if there is none
+        virtual NativeHandle nativeHandle(void) const;
+
+        // waits until recv() has data or the timeout expires. Returns false on timeout. Transceivers without a
+        // native handle cannot tell, so they return true right away and leave it to recv(). A SerialProcessor's
+        // receive thread calls this on transceivers without a native handle while other threads send, so those
+        // overrides must be safe to run alongside send()
+        virtual bool waitForData(double timeoutSeconds);
+
+        // time one character takes on the wire, including start, parity and stop bits, or 0 if the link has no fixed
+        // character rate. Lets readers work out when each byte of a read arrived, counting back from the timestamp
+        // recvPackets() gives the read. Transceivers that report a character time must stamp reads when they complete
+        virtual double secondsPerByte(void) const;
+
+        // bytes handed to send() that have not gone out on the link yet. Default implementation asks the kernel about
+        // the native handle (TIOCOUTQ, or SIOCOUTQ on a socket), and returns 0 when it cannot tell
+        virtual size_t outputBacklog(void) const;
     };
 
 
+    /**
+     * Lock-free byte ring for one writer and one reader. It lives in memory the caller provides, which may be shared
+     * between processes. The memory holds the indices, the wake-up words and the data. A waiting reader or writer
+     * sleeps on a futex (linux), or busy-waits when asked to spin. A waiting side costs the other side one wake-up
+     * syscall. Otherwise neither side makes system calls.
+     */
+    class SERLIB_API SpscByteRing
+    {
+        public:
+        SpscByteRing();
+
+        // bytes of memory needed for a ring that holds capacity bytes. capacity is rounded up to a power of two. The
+        // size is a multiple of 64, so rings can be placed back to back
+        static size_t regionSize(size_t capacity);
+
+        // uses region, which must be 64-byte aligned, as the ring. The side that creates the ring initializes it
+        // with a capacity; the other side attaches with initialize = false and reads the capacity from the region
+        bool attach(void *region, size_t regionLen, bool initialize, size_t capacity = 0);
+        bool attached(void) const;
+
+        // writes all of the data, or nothing if it does not fit. Returns whether it was written
+        bool write(const char *data, size_t numData);
+        bool writev(const SerialConstIoVec *vecs, size_t numVecs);
+
+        // reads up to numData bytes and returns the number read
+        size_t read(char *data, size_t numData);
+
+        // called by the writer to make room by dropping up to numData of the oldest unread bytes. Returns the number dropped
+        size_t discardOldest(size_t numData);
+
+        size_t readable(void) const;
+        size_t writable(void) const;
+        size_t capacity(void) const;
+
+        // wait until there is data, or room for numData bytes. Negative timeouts wait forever. Returns false on timeout
+        bool waitReadable(double timeoutSeconds, bool spin = false);
+        bool waitWritable(size_t numData, double timeoutSeconds, bool spin = false);
+
+        private:
+        struct Header
+        {
+            uint64_t capacity;
+            uint32_t magic;
+            alignas(64) std::atomic<uint64_t> writeIndex;
+            alignas(64) std::atomic<uint64_t> readIndex;
+            alignas(64) std::atomic<uint32_t> dataSignal;
+            std::atomic<uint32_t> readerWaiting;
+            alignas(64) std::atomic<uint32_t> spaceSignal;
+            std::atomic<uint32_t> writerWaiting;
+        };
+
+        void copyIn(uint64_t index, const char *data, size_t numData);
+        void copyOut(uint64_t index, char *data, size_t numData);
+        bool wait(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiting, const std::function<bool()>& ready, double timeoutSeconds, bool spin);
+        void notify(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiting);
+
+        Header *_header;
+        char *_data;
+        uint64_t _mask;
+    };
+
+
+    // what a channel does with data sent to it while it is full
+    enum IntraProcessOverflowPolicy
+    {
+        OVERFLOW_BLOCK, // the sender waits up to the channel's send timeout for the reader to make room, then drops the data
+        OVERFLOW_DROP_OLDEST, // the oldest unread bytes are discarded to make room
+        OVERFLOW_DROP_NEWEST // the data that does not fit is discarded
+    };
+
+    /**
+     * Receiving end of an in-process link, backed by an SpscByteRing. One thread may send to it (through its partner)
+     * while another receives from it.
+     */
     class SERLIB_API IntraProcessChannel
     {
         public:
-        IntraProcessChannel() = default;
+        IntraProcessChannel(
+            size_t capacity = INTRA_PROCESS_CHANNEL_CAPACITY,
+            IntraProcessOverflowPolicy overflowPolicy = OVERFLOW_DROP_NEWEST,
+            double recvTimeoutSeconds = 0,
+            double sendTimeoutSeconds = INTRA_PROCESS_SEND_TIMEOUT_SECONDS);
+        
+        IntraProcessChannel(const IntraProcessChannel&) = delete;
+        ~IntraProcessChannel();
+
         void setPartner(const std::shared_ptr<IntraProcessChannel>& partner);
         bool hasPartner() const;
 
+        // with OVERFLOW_BLOCK, waits up to sendTimeoutSeconds for the partner to make room. Negative timeouts wait forever
         void send(const char *data, size_t numData);
+
+        // waits up to recvTimeoutSeconds for data if there is none. Negative timeouts wait forever
         size_t recv(char *data, size_t numData);
 
+        // eventfd that is readable while the channel holds data (linux only)
+        NativeHandle nativeHandle() const;
+
+        // bytes sent to this channel that were discarded because it was full, under any overflow policy
+        uint64_t droppedBytes() const;
+
         protected:
         void injectData(const char *data, size_t numData);
 
         private:
-        vector<char> _data;
+        const IntraProcessOverflowPolicy _overflowPolicy;
+        const double _recvTimeoutSeconds;
+        const double _sendTimeoutSeconds;
+        vector<char> _storage;
+        SpscByteRing _ring;
         std::shared_ptr<IntraProcessChannel> _partner;
+        NativeHandle _event;
+        std::atomic<uint64_t> _droppedBytes;
     };
 
 
@@ -61,20 +216,105 @@ namespace serial_library
         void send(const char *data, size_t numData) override;
         size_t recv(char *data, size_t numData) override;
         void deinit(void) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
 
         private:
         std::shared_ptr<IntraProcessChannel> _channel;
     };
+
+
+    // what happens to a subscriber that falls more than a full ring behind the writer
+    enum BroadcastLapPolicy
+    {
+        LAP_SKIP_TO_OLDEST, // continue from the oldest data still in the ring
+        LAP_SKIP_TO_NEWEST, // skip everything that is in the ring and continue with new data
+        LAP_DISCONNECT // stop receiving
+    };
+
+    class IntraProcessBroadcastTransceiver;
+
+    /**
+     * Ring with one writer and any number of subscribers, each reading at its own cursor. The writer never waits for
+     * subscribers. A subscriber that is lapped loses the overwritten data and is handled by the lap policy.
+     */
+    class SERLIB_API IntraProcessBroadcastChannel : public std::enable_shared_from_this<IntraProcessBroadcastChannel>
+    {
+        public:
+        typedef std::shared_ptr<IntraProcessBroadcastChannel> SharedPtr;
+
+        IntraProcessBroadcastChannel(size_t capacity = INTRA_PROCESS_CHANNEL_CAPACITY, BroadcastLapPolicy lapPolicy = LAP_SKIP_TO_OLDEST);
+        IntraProcessBroadcastChannel(const IntraProcessBroadcastChannel&) = delete;
+
+        // only one thread may send
+        void send(const char *data, size_t numData);
+
+        // subscribers start with the next data sent
+        std::shared_ptr<IntraProcessBroadcastTransceiver> subscribe();
+
+        private:
+        friend class IntraProcessBroadcastTransceiver;
+
+        // reads from cursor, moving it forward. lostBytes counts data that was overwritten before it was read
+        size_t read(uint64_t& cursor, char *data, size_t numData, uint64_t& lostBytes, bool& disconnected) const;
+
+        const BroadcastLapPolicy _lapPolicy;
+        vector<char> _data;
+        const uint64_t _mask;
+        std::atomic<uint64_t>
+            _reserveIndex, // end of the data being written
+            _writeIndex; // end of the data that has been written
+    };
+
+    /**
+     * Transceiver for one end of an IntraProcessBroadcastChannel. Subscribers (from subscribe()) receive everything
+     * sent to the channel and drop what they are asked to send. Publishers send to the channel and receive nothing.
+     */
+    class SERLIB_API IntraProcessBroadcastTransceiver : public SerialTransceiver
+    {
+        public:
+        IntraProcessBroadcastTransceiver(const IntraProcessBroadcastChannel::SharedPtr& channel, bool publisher = false);
+
+        bool init(void) override;
+        void send(const char *data, size_t numData) override;
+        size_t recv(char *data, size_t numData) override;
+        void deinit(void) override;
+
+        // bytes this subscriber missed because it was lapped
+        uint64_t lostBytes(void) const;
+        
+        // whether the LAP_DISCONNECT policy disconnected this subscriber
+        bool disconnected(void) const;
+
+        private:
+        const IntraProcessBroadcastChannel::SharedPtr _channel;
+        const bool _publisher;
+        uint64_t 
+            _cursor,
+            _lostBytes;
+        
+        bool _disconnected;
+    };
 }
 
 #if defined(USE_LINUX)
 
 namespace serial_library
 {
+    struct LinuxSerialTransceiverOptions
+    {
+        bool lowLatency = false; // ASYNC_LOW_LATENCY, so that USB-serial drivers pass bytes on right away instead of every 1-16 ms
+        long readTimeoutMicroseconds = -1; // 0 or more makes recv() poll for data with this timeout instead of relying on VMIN and VTIME
+    };
+
+    const LinuxSerialTransceiverOptions DEFAULT_SERIAL_OPTIONS;
+
     class SERLIB_API LinuxSerialTransceiver : public SerialTransceiver
     {
         public:
         LinuxSerialTransceiver() = default;
+
+        // baud is the rate in bits per second (or a B* constant). Rates without a B* constant are set with termios2
         LinuxSerialTransceiver(
             const std::string& fileName,
             int baud,
@@ -83,15 +323,36 @@ namespace serial_library
             int mode = O_RDWR,
             int bitsPerByte = CS8,
             bool twoStopBits = false,
-            bool parityBit = false);
+            bool parityBit = false,
+            const LinuxSerialTransceiverOptions& options = DEFAULT_SERIAL_OPTIONS);
 
         bool init(void) override;
         void send(const char *data, size_t numData) override;
         size_t recv(char *data, size_t numData) override;
         void deinit(void) override;
+        void sendv(const SerialConstIoVec *vecs, size_t numVecs) override;
+        size_t recvv(const SerialIoVec *vecs, size_t numVecs) override;
+
+        // stamps the bytes with the time they were picked up from the port
+        size_t recvPackets(char *data, size_t numData, SerialPacketInfo *packets, size_t maxPackets) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
+        
+        // from the baud rate the port actually runs at and the character format
+        double secondsPerByte(void) const override;
+
+        // toggles ASYNC_LOW_LATENCY. Returns false if the driver does not support it (ptys, for example)
+        bool setLowLatency(bool enable);
 
         private:
+        bool waitReadable(void);
+
+        // writes all of the pieces, picking up after short writes. Consumes iovs
+        bool writeAll(iovec *iovs, size_t numIovs);
+
         std::string fileName;
+        LinuxSerialTransceiverOptions options;
+        double characterTime;
         int
             file,
             baud,
@@ -107,6 +368,19 @@ namespace serial_library
     };
 
 
+    struct LinuxUDPTransceiverOptions
+    {
+        size_t batchSize = 1; // datagrams moved per recvmmsg()/sendmmsg() call. 1 keeps the plain recv()/send() path
+        size_t maxDatagramSize = PROCESSOR_BUFFER_SIZE; // size of each receive slot when batching
+        int recvBufferSize = 0; // SO_RCVBUF, 0 keeps the system default
+        int sendBufferSize = 0; // SO_SNDBUF, 0 keeps the system default
+        bool useGso = false; // sendPackets() sends runs of equal-size datagrams as one UDP_SEGMENT send
+        bool useGro = false; // let the stack merge received datagrams (UDP_GRO). they are split again before being returned
+        bool receiveTimestamps = false; // report when the kernel received each datagram (SO_TIMESTAMPNS) from recvPackets()
+    };
+
+    const LinuxUDPTransceiverOptions DEFAULT_UDP_OPTIONS;
+
     class SERLIB_API LinuxUDPTransceiver : public SerialTransceiver
     {
         public:
@@ -117,14 +391,34 @@ namespace serial_library
             double recvTimeoutSeconds = 0.01,
             bool skipBind = false, 
             bool skipConnect = false, 
-            bool allowAddrReuse=false);
+            bool allowAddrReuse=false,
+            const LinuxUDPTransceiverOptions& options = DEFAULT_UDP_OPTIONS);
 
         bool init(void) override;
         void send(const char *data, size_t numData) override;
         size_t recv(char *data, size_t numData) override;
         void deinit(void) override;
+        void sendv(const SerialConstIoVec *vecs, size_t numVecs) override;
+        size_t recvv(const SerialIoVec *vecs, size_t numVecs) override;
+        size_t recvPackets(char *data, size_t numData, SerialPacketInfo *packets, size_t maxPackets) override;
+        void sendPackets(const SerialConstIoVec *packets, size_t numPackets) override;
+        bool waitForData(double timeoutSeconds) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
+
+        size_t outputBacklog(void) const override;
+
+        // datagrams sendPackets() gave up on because a send failed
+        uint64_t droppedDatagrams(void) const;
 
         private:
+        bool usingSlots(void) const;
+        void updateReadiness(void);
+        void closeReadiness(void);
+        bool fillSlots(void);
+        size_t sendBatch(const SerialConstIoVec *packets, size_t numPackets);
+        size_t sendSegmented(const SerialConstIoVec *packets, size_t numPackets);
+
         const std::string address;
         const int port;
         const double recvTimeoutSeconds;
@@ -132,7 +426,25 @@ namespace serial_library
             allowAddrReuse,
             skipBind,
             skipConnect;
+        
+        const LinuxUDPTransceiverOptions options;
         int sock;
+
+        // datagrams received by recvmmsg() that have not been returned yet
+        vector<char> 
+            slots,
+            slotControl;
+        
+        vector<mmsghdr> slotHeaders;
+        vector<iovec> slotIovs;
+        size_t slotSize;
+        vector<SerialPacketInfo> pending; // offsets into slots
+        size_t nextPending;
+        bool gsoEnabled;
+        std::atomic<uint64_t> dropped;
+        int
+            pollSet, // epoll set of sock and pendingEvent, when datagrams are taken in batches
+            pendingEvent; // readable while pending has datagrams left
     };
 
     /**
@@ -151,6 +463,10 @@ namespace serial_library
         void send(const char *data, size_t numData) override;
         size_t recv(char *data, size_t numData) override;
         void deinit(void) override;
+        void sendv(const SerialConstIoVec *vecs, size_t numVecs) override;
+        size_t recvv(const SerialIoVec *vecs, size_t numVecs) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
 
         private:
         LinuxUDPTransceiver
@@ -158,6 +474,278 @@ namespace serial_library
             sendUDP;
     };
 
+    /**
+     * Publishes to and subscribes to a UDP multicast group. One send() reaches every subscriber of the group. Bound with
+     * SO_REUSEADDR, so several subscribers on one host can share the port. interfaceAddress selects the interface
+     * used for sending and joining ("0.0.0.0" lets the kernel choose).
+     */
+    class SERLIB_API LinuxUDPMulticastTransceiver : public SerialTransceiver
+    {
+        public:
+        LinuxUDPMulticastTransceiver(
+            const std::string& groupAddress,
+            int port,
+            const std::string& interfaceAddress = "0.0.0.0",
+            int ttl = 1,
+            bool loopback = true,
+            double recvTimeoutSeconds = 0.01);
+        
+        bool init(void) override;
+        void send(const char *data, size_t numData) override;
+        size_t recv(char *data, size_t numData) override;
+        void deinit(void) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
+
+        // receive from additional groups on the same port, or stop receiving from one
+        bool joinGroup(const std::string& groupAddress);
+        bool leaveGroup(const std::string& groupAddress);
+
+        // hops that sent datagrams may take, and whether they are delivered back to this host
+        bool setTtl(int ttl);
+        bool setLoopback(bool loopback);
+
+        private:
+        bool changeMembership(const std::string& groupAddress, int option);
+
+        const std::string
+            groupAddress,
+            interfaceAddress;
+        
+        const int port;
+        int ttl;
+        bool loopback;
+        const double recvTimeoutSeconds;
+        int sock;
+        sockaddr_in group;
+    };
+
+    /**
+     * One UDP socket shared by many remote devices. Datagrams are received in batches with recvmmsg() and routed by
+     * source address, through a hash table, to the LinuxUDPPeerTransceiver for that device. Each device therefore gets
+     * its own processor and parser state. Replies are queued and go out together with sendmmsg() on flush().
+     * Servers must be owned by a shared_ptr because peers keep a reference to them.
+     */
+    class SERLIB_API LinuxUDPServerTransceiver : public std::enable_shared_from_this<LinuxUDPServerTransceiver>
+    {
+        public:
+        typedef std::shared_ptr<LinuxUDPServerTransceiver> SharedPtr;
+        typedef std::function<void(const std::string& address, int port)> NewPeerCallback;
+
+        LinuxUDPServerTransceiver(int port, bool allowAddrReuse = false, const LinuxUDPTransceiverOptions& options = DEFAULT_UDP_OPTIONS);
+        LinuxUDPServerTransceiver(const LinuxUDPServerTransceiver&) = delete;
+        ~LinuxUDPServerTransceiver();
+
+        bool init(void);
+        void deinit(void);
+
+        // transceiver for the device at address:port. Datagrams from there are routed to it, and what it sends goes back there
+        SerialTransceiver::UniquePtr peer(const std::string& address, int port);
+
+        // called from receive() the first time a datagram arrives from an address without a peer. The datagram is kept
+        // for a peer created during the callback
+        void setNewPeerCallback(const NewPeerCallback& callback);
+
+        // receives everything waiting on the socket, waiting up to timeoutSeconds for the first datagram (forever if 
+        // negative), and routes it to the peers. Returns the number of datagrams received
+        size_t receive(double timeoutSeconds = 0);
+
+        // sends the queued replies. Those the socket has no room for stay queued for the next flush. Returns the number 
+        // of datagrams sent
+        size_t flush(void);
+
+        NativeHandle nativeHandle(void) const;
+        size_t numPeers(void);
+
+        private:
+        friend class LinuxUDPPeerTransceiver;
+
+        struct Peer
+        {
+            sockaddr_in address;
+            bool attached;
+            std::deque<vector<char>> received;
+        };
+
+        struct OutboundDatagram
+        {
+            sockaddr_in to;
+            vector<char> data;
+        };
+
+        static uint64_t peerKey(const sockaddr_in& address);
+        bool resolve(const std::string& address, int port, sockaddr_in& resolved);
+        void attachPeer(uint64_t key, const sockaddr_in& address);
+        void detachPeer(uint64_t key);
+        void queueSend(uint64_t key, const char *data, size_t numData);
+        size_t takeReceived(uint64_t key, char *data, size_t numData);
+        bool hasReceived(uint64_t key);
+        size_t flushLocked(void);
+
+        const int port;
+        const bool allowAddrReuse;
+        const LinuxUDPTransceiverOptions options;
+        int sock;
+        NewPeerCallback newPeerCallback;
+
+        std::unordered_map<uint64_t, Peer> peers;
+        vector<OutboundDatagram> outbound;
+        vector<char> slots;
+        vector<mmsghdr> slotHeaders;
+        vector<iovec> slotIovs;
+        vector<sockaddr_in> slotAddresses;
+        std::recursive_mutex lock; // held while the new peer callback runs, which may create peers
+    };
+
+    class SERLIB_API LinuxUDPPeerTransceiver : public SerialTransceiver
+    {
+        public:
+        LinuxUDPPeerTransceiver(const LinuxUDPServerTransceiver::SharedPtr& server, const sockaddr_in& address);
+
+        bool init(void) override;
+        void send(const char *data, size_t numData) override;
+
+        // returns the next datagram from the peer that the server has received, if any. Does not touch the socket
+        size_t recv(char *data, size_t numData) override;
+        void deinit(void) override;
+
+        // runs the server's receive() if this peer has nothing waiting
+        bool waitForData(double timeoutSeconds) override;
+        unsigned int capabilities(void) const override;
+
+        private:
+        const LinuxUDPServerTransceiver::SharedPtr server;
+        const sockaddr_in address;
+        const uint64_t key;
+    };
+
+    enum SharedMemoryWaitMode
+    {
+        SHM_WAIT_FUTEX, // sleep until the other process signals
+        SHM_WAIT_SPIN // busy-wait. lowest latency, but keeps a core busy while waiting
+    };
+
+    /**
+     * Connects two processes through a pair of SpscByteRings in a shared memfd region. It is used like
+     * LinuxSocketpairTransceiver: the parent creates the region in init() and passes childFd() to the child, which
+     * constructs its transceiver from that fd. Frames are copied once into the ring and once out of it, without
+     * system calls unless the other side is asleep. recv() waits up to recvTimeoutSeconds for data, and send() up to
+     * sendTimeoutSeconds for room in a full ring before dropping the frame.
+     */
+    class SERLIB_API LinuxSharedMemoryTransceiver : public SerialTransceiver
+    {
+        public:
+        LinuxSharedMemoryTransceiver(SharedMemoryWaitMode waitMode = SHM_WAIT_FUTEX, size_t capacity = 65536, double recvTimeoutSeconds = 0.01, double sendTimeoutSeconds = 0.01);
+        LinuxSharedMemoryTransceiver(int childFd, SharedMemoryWaitMode waitMode = SHM_WAIT_FUTEX, double recvTimeoutSeconds = 0.01, double sendTimeoutSeconds = 0.01);
+        ~LinuxSharedMemoryTransceiver();
+
+        int childFd() const;
+
+        bool init(void) override;
+        void send(const char *data, size_t numData) override;
+        size_t recv(char *data, size_t numData) override;
+        void deinit(void) override;
+        void sendv(const SerialConstIoVec *vecs, size_t numVecs) override;
+        bool waitForData(double timeoutSeconds) override;
+        unsigned int capabilities(void) const override;
+
+        private:
+        const size_t _capacity;
+        const SharedMemoryWaitMode _waitMode;
+        const double
+            _recvTimeoutSeconds,
+            _sendTimeoutSeconds;
+        
+        const bool _isParent;
+        int _fd;
+        void *_region;
+        size_t _regionLen;
+        SpscByteRing
+            _inbound,
+            _outbound;
+    };
+
+    struct LinuxTCPTransceiverOptions
+    {
+        bool noDelay = true; // TCP_NODELAY, so that small frames go out right away instead of waiting on Nagle's algorithm
+        double connectTimeoutSeconds = 1; // how long init() waits for a client connection to be established
+        double reconnectIntervalSeconds = 0.5; // minimum time between connection attempts after the connection drops
+        double sendTimeoutSeconds = 0.1; // SO_SNDTIMEO, how long a send waits for room in the socket buffer
+        int recvBufferSize = 0; // SO_RCVBUF, 0 keeps the system default
+        int sendBufferSize = 0; // SO_SNDBUF, 0 keeps the system default
+    };
+
+    const LinuxTCPTransceiverOptions DEFAULT_TCP_OPTIONS;
+
+    /**
+     * Byte stream over TCP. A client connects to address:port. A server listens on address:port and talks to one
+     * client at a time. If the connection drops, send() and recv() reconnect (or accept the next client) without
+     * blocking for longer than their timeouts. The socket changes when that happens, but nativeHandle() does not: it
+     * is an epoll set that is readable when the connection has data, a client is waiting to be accepted, a connection
+     * attempt finished or the next reconnect is due, so polling it and calling recv() keeps the link going.
+     */
+    class SERLIB_API LinuxTCPTransceiver : public SerialTransceiver
+    {
+        public:
+        LinuxTCPTransceiver(
+            const std::string& address,
+            int port,
+            bool server = false,
+            double recvTimeoutSeconds = 0.01,
+            bool allowAddrReuse = false,
+            const LinuxTCPTransceiverOptions& options = DEFAULT_TCP_OPTIONS);
+
+        bool init(void) override;
+        void send(const char *data, size_t numData) override;
+        size_t recv(char *data, size_t numData) override;
+        void deinit(void) override;
+        void sendv(const SerialConstIoVec *vecs, size_t numVecs) override;
+        size_t recvv(const SerialIoVec *vecs, size_t numVecs) override;
+        void sendPackets(const SerialConstIoVec *packets, size_t numPackets) override;
+        bool waitForData(double timeoutSeconds) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
+        size_t outputBacklog(void) const override;
+
+        // while corked (TCP_CORK), partial segments are held back so that several sends leave as full segments
+        void setCork(bool cork);
+        bool connected(void) const;
+
+        private:
+        bool ensureConnected(double timeoutSeconds);
+        bool startConnect(void);
+        bool finishConnect(double timeoutSeconds);
+        bool acceptClient(double timeoutSeconds);
+        void configureConnection(void);
+        void dropConnection(void);
+        void watch(int fd, uint32_t events);
+        void unwatch(int fd);
+        void armReconnect(double seconds);
+        size_t handleRecv(ssize_t ret);
+        bool writeAll(iovec *iovs, size_t numIovs, int flags);
+
+        const std::string address;
+        const int port;
+        const bool 
+            server,
+            allowAddrReuse;
+        
+        const double recvTimeoutSeconds;
+        const LinuxTCPTransceiverOptions options;
+        sockaddr_in remote;
+        int 
+            listenSock,
+            sock,
+            pollSet, // nativeHandle(). holds whichever of the sockets and the timer can make progress
+            reconnectTimer; // client only. expires when the next connection attempt is due
+        
+        bool 
+            connecting,
+            corked;
+        
+        Time lastConnectAttempt;
+    };
+
     class LinuxSocketpairTransceiver : public SerialTransceiver
     {
         public:
@@ -171,6 +759,10 @@ namespace serial_library
         void send(const char *data, size_t numData) override;
         size_t recv(char *data, size_t numData) override;
         void deinit(void) override;
+        void sendv(const SerialConstIoVec *vecs, size_t numVecs) override;
+        size_t recvv(const SerialIoVec *vecs, size_t numVecs) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
 
         private:
         const int
@@ -188,6 +780,147 @@ namespace serial_library
 
         bool _initialized;
     };
+
+    /**
+     * Shared io_uring instance for LinuxIoUringTransceivers. Receives stay posted into a ring of kernel-selected
+     * buffers (multishot on sockets), and everything the attached links send is queued until flush(), which hands
+     * it to the kernel with one io_uring_enter(). If the kernel does not support io_uring (or buffer rings),
+     * available() returns false and the transceivers fall back to the transceiver they wrap.
+     */
+    class SERLIB_API LinuxIoUringEngine
+    {
+        public:
+        typedef std::shared_ptr<LinuxIoUringEngine> SharedPtr;
+        typedef std::unique_ptr<LinuxIoUringEngine> UniquePtr;
+
+        LinuxIoUringEngine(unsigned int queueDepth = 256, unsigned int numBuffers = 64, size_t bufferSize = PROCESSOR_BUFFER_SIZE);
+        LinuxIoUringEngine(const LinuxIoUringEngine&) = delete;
+        ~LinuxIoUringEngine();
+
+        bool available() const;
+
+        // submits every queued send and receive with one io_uring_enter(). Returns the number of submissions
+        size_t flush();
+
+        // flushes, then handles completions, waiting up to timeoutSeconds (forever if negative) if there are none. 
+        // Returns the number of completions handled
+        size_t poll(double timeoutSeconds);
+
+        // ring fd, readable when completions are waiting
+        NativeHandle nativeHandle() const;
+
+        private:
+        friend class LinuxIoUringTransceiver;
+
+        struct Link
+        {
+            int fd;
+            bool
+                isSocket,
+                isStream,
+                multishot,
+                recvPosted,
+                closed,
+                sendInFlight;
+            
+            std::deque<vector<char>> received; // one entry per completed receive, so datagrams keep their boundaries
+            size_t receivedOffset; // bytes of the first entry already taken (stream links only)
+            vector<char> outbound; // stream links only, sent as one write when the previous one completes
+        };
+
+        struct Send
+        {
+            uint64_t link;
+            vector<char> data;
+            size_t offset;
+        };
+
+        uint64_t attach(int fd);
+        void detach(uint64_t link);
+        void queueSend(uint64_t link, const char *data, size_t numData);
+        size_t takeReceived(uint64_t link, char *data, size_t numData);
+        bool hasReceived(uint64_t link);
+
+        void *nextSqe();
+        void prepRecv(uint64_t linkId, const Link& link);
+        void prepSend(uint64_t sendId, const Send& send);
+        size_t submitLocked();
+        size_t reapLocked();
+        void recycleBuffer(unsigned short bufferId);
+        void unmap();
+
+        int _ring;
+        unsigned int
+            _numBuffers,
+            _sqEntries,
+            _toSubmit;
+
+        size_t 
+            _bufferSize,
+            _sqRingSize,
+            _cqRingSize,
+            _sqesSize,
+            _bufRingSize;
+        
+        void
+            *_sqRing,
+            *_cqRing,
+            *_sqes,
+            *_bufRing;
+        
+        unsigned
+            *_sqHead,
+            *_sqTail,
+            *_sqMask,
+            *_sqArray,
+            *_cqHead,
+            *_cqTail,
+            *_cqMask;
+        
+        void *_cqes;
+        vector<char> _buffers;
+        uint64_t
+            _nextLink,
+            _nextSend;
+        
+        size_t _outstandingRecvs;
+        
+        map<uint64_t, Link> _links;
+        map<uint64_t, Send> _sends;
+        mutex _lock;
+    };
+
+    /**
+     * Runs an existing transceiver's I/O through a LinuxIoUringEngine. init() and deinit() are forwarded, then the
+     * wrapped transceiver's handle is attached to the engine. send() only queues data until the engine is flushed 
+     * (once per tick, by recv() or by the user), so frames sent to many links go out with a single syscall. The
+     * wrapped transceiver must send and receive on its native handle (LinuxDualUDPTransceiver does not).
+     */
+    class SERLIB_API LinuxIoUringTransceiver : public SerialTransceiver
+    {
+        public:
+        LinuxIoUringTransceiver(
+            const SerialTransceiver::SharedPtr& transceiver,
+            const LinuxIoUringEngine::SharedPtr& engine,
+            double recvTimeoutSeconds = 0.01);
+        
+        bool init(void) override;
+        void send(const char *data, size_t numData) override;
+        size_t recv(char *data, size_t numData) override;
+        void deinit(void) override;
+        unsigned int capabilities(void) const override;
+        NativeHandle nativeHandle(void) const override;
+        bool waitForData(double timeoutSeconds) override;
+
+        private:
+        bool usingEngine() const;
+
+        SerialTransceiver::SharedPtr _transceiver;
+        LinuxIoUringEngine::SharedPtr _engine;
+        const double _recvTimeoutSeconds;
+        uint64_t _link;
+        bool _attached;
+    };
 }
 
 #endif
@@ -299,6 +1032,21 @@ namespace serial_library
     SERLIB_API SerialFrame normalizeSerialFrame(const SerialFrame& frame);
     SERLIB_API SerialFramesMap normalizeSerialFramesMap(const SerialFramesMap& map);
 
+    #if defined(USE_LINUX)
+    // converts library io vectors to iovecs for readv()/writev(). Returns false if there are more than maxIovs pieces
+    SERLIB_API bool toIovecs(const SerialIoVec *vecs, size_t numVecs, iovec *iovs, size_t maxIovs);
+    SERLIB_API bool toIovecs(const SerialConstIoVec *vecs, size_t numVecs, iovec *iovs, size_t maxIovs);
+
+    // sets any baud rate on a serial port with termios2 and BOTHER, or reads the current one. Returns false (or -1) on failure
+    SERLIB_API bool setCustomBaud(int fd, int baud);
+    SERLIB_API int getBaud(int fd);
+    #endif
+
+    // delta frames carry the frame's header (everything through the sync and frame fields), a presence bitmap
+    // with one bit per delta field, the bytes of each present field, and finally the checksum if the frame has one.
+    SERLIB_API size_t deltaFrameHeaderLength(const SerialFrame& frame);
+    SERLIB_API vector<SerialFieldId> deltaFrameFields(const SerialFrame& frame);
+
     // packs c string into primitive type. 0 is most significant
     template<typename T>
     T convertFromCString(const char *str, size_t strLen)
@@ -345,6 +1093,15 @@ namespace serial_library
         return numData;
     }
 
+    // SerialData holding a value, encoded like setFieldValue() does
+    template<typename T>
+    SerialData serialDataFromValue(const T& val)
+    {
+        SerialData data;
+        data.numData = convertToCString(val, data.data, sizeof(T));
+        return data;
+    }
+
     template<typename T>
     T convertData(const SerialDataStamped& data)
     {
@@ -379,6 +1136,46 @@ namespace serial_library
     };
 
 
+    // holds a ProtectedResource while acquired, and releases it when it goes out of scope
+    template<typename T>
+    class ProtectedResourceGuard
+    {
+        public:
+        ProtectedResourceGuard(ProtectedResource<T>& resource)
+        : resource(resource) { }
+
+        ProtectedResourceGuard(const ProtectedResourceGuard&) = delete;
+        ProtectedResourceGuard& operator=(const ProtectedResourceGuard&) = delete;
+
+        ~ProtectedResourceGuard()
+        {
+            release();
+        }
+
+        T& acquire()
+        {
+            if(!held)
+            {
+                held = resource.lockResource();
+            }
+
+            return *held;
+        }
+
+        void release()
+        {
+            if(held)
+            {
+                resource.unlockResource(std::move(held));
+            }
+        }
+
+        private:
+        ProtectedResource<T>& resource;
+        std::unique_ptr<T> held;
+    };
+
+
     static void defaultNewMessageCallback(const SerialValuesMap& map)
     { }
 
@@ -404,6 +1201,9 @@ namespace serial_library
 
     const SerialProcessorCallbacks DEFAULT_CALLBACKS;
 
+    // called with the values of a decoded frame. Returns true once it has what it wanted and should be removed
+    typedef std::function<bool(const SerialValuesMap&)> FrameListener;
+
 
     class SerialProcessor
     {
@@ -437,6 +1237,9 @@ namespace serial_library
         bool hasTransceiver();
         void setTransceiver(SerialTransceiver::UniquePtr& transceiver);
         void resetTransceiver();
+
+        // handle of the transceiver, for waiting on incoming data in an external event loop
+        NativeHandle nativeHandle();
         void update(const Time& now);
         bool hasDataForField(SerialFieldId field);
         Time getLastMsgRecvTime(void) const;
@@ -456,22 +1259,180 @@ namespace serial_library
         template<typename T>
         void setFieldValue(SerialFieldId field, const T& val, const Time& now)
         {
-            SerialData data;
-            data.numData = convertToCString(val, data.data, sizeof(T));
-            setField(field, data, now);
+            setField(field, serialDataFromValue(val), now);
         }
 
+        // sets all of the fields under one lock. A frame sent or decoded on another thread sees all of them or none
+        void setFields(const map<SerialFieldId, SerialData>& fields, const Time& now);
+
+        // copies the fields that have data into out, all under one lock, so they never mix values from before and 
+        // after a decode or a setFields(). Returns false if any of them has no data yet
+        bool getFields(const vector<SerialFieldId>& fields, SerialValuesMap& out);
+
         void send(const SerialFrameId& frameId);
+
+        // encodes all of the frames back-to-back and hands them to the transceiver in as few writes as possible
+        void sendBatch(const vector<SerialFrameId>& frameIds);
         unsigned short failedOfLastTenMessages();
 
+        // queues the frame and sends what the output budget allows. A frame that is queued again before it goes out
+        // is still sent once, with the values its fields have when it does, and at the higher of the two priorities.
+        // Queued frames go out highest priority first, oldest first within a priority. This call only avoids waiting
+        // on the link once a budget is set: with the default SIZE_MAX budget it sends right away, like sendBatch(), and
+        // blocks while the transceiver does. Frames held back by the budget are only sent when update() or
+        // flushSendQueue() is called or the receive thread runs, so without those they wait until the next queueSend()
+        void queueSend(const SerialFrameId& frameId, int priority = 0);
+
+        // sends queued frames until the next one would push the transceiver's outputBacklog() past the budget.
+        // Returns the number of frames sent
+        size_t flushSendQueue(void);
+        size_t queuedSends(void);
+
+        // caps the bytes left waiting in the kernel's output buffer by queued sends, so that a new command never sits
+        // behind more than that on a saturated link. SIZE_MAX, the default, sends queued frames right away
+        void setOutputBudget(size_t maxBacklogBytes);
+
+        // the same cap, as the time the link takes to send the backlog. Only applies to transceivers that know their
+        // secondsPerByte(). Negative disables it
+        void setOutputLatencyBudget(double seconds);
+
+        // when enabled, send() only transmits the fields of the frame that changed since the last send, with a full
+        // keyframe every keyframeInterval sends. A keyframeInterval of 0 disables delta encoding for the frame.
+        // Delta frames are only decoded for frames it is enabled for, and callbacks, listeners and waiters get the
+        // whole frame, with the fields left out at their last values
+        void setDeltaEncoding(const SerialFrameId& frameId, unsigned int keyframeInterval);
+
+        // for transceivers that deliver whole messages (TRANSCEIVER_CAP_MESSAGE_BOUNDARIES). Each message is parsed 
+        // from its first byte as back-to-back frames that must fill it exactly, without searching for the sync or 
+        // keeping partial frames between updates. Enabling it on any other transceiver throws
+        void setPacketMode(bool enabled);
+
+        // runs update() on a thread of its own, which sleeps on the transceiver's native handle until data arrives.
+        // Transceivers without a handle are waited on through waitForData(). If that returns right away and recv() has
+        // nothing, the thread backs off for a millisecond before asking again.
+        // Nothing else may call update() until stop(). stop() may be called from the receive thread itself, for
+        // example from a frame listener, in which case the thread ends once the listener returns. A processor destroyed
+        // on its own receive thread detaches it, and nothing on that thread may use the processor afterwards
+        void start(void);
+        void stop(void);
+        bool running(void) const;
+
+        // block until the field, the frame or any frame is decoded after the call, or the timeout (in seconds, 
+        // negative waits forever) runs out. Return false on timeout. Decoding wakes the waiters right away, whether
+        // it happened on the receive thread or in an update() called on another thread
+        bool waitForField(SerialFieldId field, double timeoutSeconds);
+        bool waitForFrame(const SerialFrameId& frameId, double timeoutSeconds);
+        bool waitForAny(double timeoutSeconds);
+
+        // sends the request frame, and completes the future with the values of the first response frame decoded after
+        // it. Requests without a correlation field are answered in the order they were sent. With one, the response 
+        // must carry the value the request was sent with in that field, so answers can come back in any order. A 
+        // timeout of 0 or more fails the future with a NonFatalSerialLibraryException once it passes. Responses are
+        // matched in update(), so something else must be calling it, such as the receive thread from start()
+        std::future<SerialValuesMap> sendAsync(
+            const SerialFrameId& requestFrame,
+            const SerialFrameId& responseFrame,
+            double timeoutSeconds = -1,
+            SerialFieldId correlationField = FIELD_NONE);
+        
+        // sendAsync() that waits for the response. Returns false on timeout. The response can be read with getField()
+        bool sendAndAwait(
+            const SerialFrameId& requestFrame,
+            const SerialFrameId& responseFrame,
+            double timeoutSeconds,
+            SerialFieldId correlationField = FIELD_NONE);
+
+        // calls the listener from the parse path, right after each frame with the id is decoded, until it returns
+        // true. Listeners may send, but must not call update(). Returns an id for removeFrameListener()
+        uint64_t addFrameListener(const SerialFrameId& frameId, const FrameListener& listener);
+
+        // once this returns, the listener is not running on any other thread and will not be called again, so what it
+        // refers to can be freed. A listener may remove itself. Must not be called while holding anything the listener 
+        // waits on
+        void removeFrameListener(uint64_t id);
+
         private:
+        enum FrameDecodeResult
+        {
+            FRAME_DECODED,
+            FRAME_INVALID,
+            FRAME_INCOMPLETE
+        };
+
+        struct PendingRequest
+        {
+            uint64_t id;
+            SerialFrameId responseFrame;
+            SerialFieldId correlationField;
+            SerialData correlationValue;
+            bool expires;
+            Time deadline;
+            std::promise<SerialValuesMap> response;
+        };
+
+        // where a frame sits in the transmission buffer
+        struct EncodedFrame
+        {
+            SerialFrameId frameId;
+            size_t
+                offset,
+                length;
+            
+            bool delta;
+        };
+
+        struct QueuedSend
+        {
+            int priority;
+            uint64_t sequence; // when the frame was first queued
+        };
+
+        struct DeltaEncodingState
+        {
+            unsigned int
+                keyframeInterval,
+                sendsSinceKeyframe;
+            
+            bool primed;
+            map<SerialFieldId, SerialData> lastSent;
+        };
+
         void ctorFunc(const char syncValue[MAX_DATA_BYTES], size_t syncLen);
+        Time arrivalTime(size_t offset, const Time& now) const;
+        void consumeArrivalMarks(size_t amountRemoved);
+        void decodePacket(const char *packet, size_t packetLen, size_t msgStartOffsetFromSync, const Time& now);
+        void updateFailureStats(bool failed);
+        FrameDecodeResult decodeFrame(const char *msgStart, size_t msgLen, const Time& now, size_t& frameLen);
+        // encoders leave checksums out, so that checksum callbacks do not run with the values locked
+        // delta-encoded frames update a copy of their state in nextStates, which sendBatch() keeps once the write goes out
+        size_t encodeFrameForSend(const SerialFrameId& frameId, const SerialValuesMap& values, map<SerialFrameId, DeltaEncodingState>& nextStates, char *dst, size_t dstLen, bool& delta);
+        size_t encodeFrame(const SerialFrameId& frameId, const SerialValuesMap& values, char *dst, size_t dstLen);
+        size_t encodeDeltaFrame(const SerialFrameId& frameId, const SerialValuesMap& values, DeltaEncodingState& state, char *dst, size_t dstLen, bool& delta);
+        void insertChecksum(const EncodedFrame& encoded, char *dst);
+        bool decodesDelta(const SerialFrameId& frameId);
+        void checkSendable(const SerialFrameId& frameId, const SerialValuesMap& values) const;
+        SerialData getFrameFieldData(const SerialFrameId& frameId, SerialFieldId field, const SerialValuesMap& values);
+        void receiveLoop(uint64_t generation);
+        void notifyDecoded(const SerialFrameId& frameId, const SerialValuesMap& msgValues);
+        bool waitForDecode(const std::function<uint64_t(void)>& count, double timeoutSeconds);
+        uint64_t sendRequest(
+            const SerialFrameId& requestFrame,
+            const SerialFrameId& responseFrame,
+            double timeoutSeconds,
+            SerialFieldId correlationField,
+            std::future<SerialValuesMap>& response);
+        
+        void cancelRequest(uint64_t id);
+        void completeRequests(const SerialFrameId& frameId, const SerialValuesMap& msgValues);
+        void expireRequests(void);
+        void callFrameListeners(const SerialFrameId& frameId, const SerialValuesMap& msgValues);
+        void finishListenerCall(uint64_t id);
+        SerialValuesMap userValues(const SerialValuesMap& msgValues) const;
 
         // regular member vars
         char msgBuffer[PROCESSOR_BUFFER_SIZE]; // update() only
         char updateChecksumlessBuffer[PROCESSOR_BUFFER_SIZE]; //update() only
         char sendChecksumlessBuffer[PROCESSOR_BUFFER_SIZE]; //send() only
-        char updateTransmissionBuffer[PROCESSOR_BUFFER_SIZE]; //update() only
         char sendTransmissionBuffer[PROCESSOR_BUFFER_SIZE]; //send() only
         char fieldBuf[MAX_DATA_BYTES]; //update() only
 
@@ -481,6 +1442,9 @@ namespace serial_library
             totalOfLastTenCounter;
         
         size_t msgBufferCursorPos;
+        vector<SerialPacketInfo> arrivalMarks; // when the bytes from each offset in msgBuffer arrived. update() only
+        double byteTime; // transceiver's secondsPerByte(), for placing bytes within a read. update() only
+        bool packetMode; //update() only
         Time lastMsgRecvTime;
         char syncValue[MAX_DATA_BYTES];
         const size_t syncValueLen;
@@ -490,11 +1454,204 @@ namespace serial_library
         const bool switchEndianness;
         const SerialProcessorCallbacks callbacks;
         const std::string debugName;
+        map<SerialFrameId, DeltaEncodingState> deltaStates; //send() only
         
         // "thread-safe" resources 
         ProtectedResource<SerialValuesMap> valueMapResource;
         ProtectedResource<SerialTransceiver> transceiverResource;
+
+        // receive thread, and how many times each field and frame has been decoded so waiters can tell when it happens.
+        // the receive thread waits on the transceiver under transceiverWaitLock instead of transceiverResource, so that
+        // sends go on meanwhile and setTransceiver() cannot pull the transceiver out from under the wait
+        std::thread receiveThread;
+        std::atomic<bool> receiving;
+        std::atomic<uint64_t> receiveGeneration; // the run that should be going. each receive thread has its own
+        uint64_t loopGeneration; // the running thread's, for start() from that thread
+        std::atomic<std::thread::id> loopThread; // the running thread, so that start() and stop() can tell it apart
+        std::mutex receiveControlLock; // start() and stop() from other threads
+        std::mutex transceiverWaitLock;
+        uint64_t bytesReceived; // update() only
+        std::mutex decodeLock;
+        std::condition_variable decodeCondition;
+        uint64_t numDecoded;
+        map<SerialFrameId, uint64_t> frameDecodes;
+        map<SerialFieldId, uint64_t> fieldDecodes;
+
+        // requests waiting for a response, oldest first
+        std::mutex requestLock;
+        list<PendingRequest> pendingRequests;
+        std::atomic<size_t> numPendingRequests;
+        uint64_t nextRequestId;
+
+        // listeners, and the threads calling each one right now so that removing it can wait for them
+        std::mutex listenerLock;
+        std::condition_variable listenerCondition;
+        map<uint64_t, pair<SerialFrameId, FrameListener>> frameListeners;
+        map<uint64_t, vector<std::thread::id>> listenerCalls;
+        std::atomic<size_t> numFrameListeners;
+        uint64_t nextListenerId;
+
+        // sendBatch() shares the transmission buffer and the delta states between threads
+        std::mutex sendLock;
+
+        // frames set up with setDeltaEncoding(), the only ones whose delta frames update() decodes
+        std::mutex deltaFramesLock;
+        set<SerialFrameId> deltaFrames;
+
+        // frames from queueSend(), at most one per id, and the budget they go out under
+        std::mutex sendQueueLock;
+        std::mutex flushLock;
+        map<SerialFrameId, QueuedSend> sendQueue;
+        std::atomic<size_t> numQueuedSends;
+        uint64_t nextSendSequence;
+        size_t outputBudgetBytes;
+        double outputBudgetSeconds;
+    };
+
+    // how on time a scheduled frame (or all of them) has been sent. Lateness is how long after its deadline a frame went out
+    struct SchedulerStats
+    {
+        uint64_t sends = 0;
+        uint64_t missedDeadlines = 0; // periods skipped because the scheduler ran too late to send them at all
+        double meanLatenessSeconds = 0;
+        double jitterSeconds = 0; // standard deviation of the lateness
+        double maxLatenessSeconds = 0;
+    };
+
+    /**
+     * Sends frames periodically against absolute deadlines, so sends do not drift. Entries are kept in a hierarchical
+     * timer wheel, so adding, removing and firing them does not depend on how many there are. Deadlines fall at 
+     * phase + k * period from a common origin, so entries with the same period and phase line up. Frames of one 
+     * processor that come due together go out in one sendBatch(), highest priority first. A deadline is never 
+     * fired early, and late by at most one tick plus however late runDue() is called.
+     */
+    class SERLIB_API SerialScheduler
+    {
+        public:
+        typedef std::shared_ptr<SerialScheduler> SharedPtr;
+        typedef std::unique_ptr<SerialScheduler> UniquePtr;
+        typedef uint64_t EntryId;
+
+        SerialScheduler(double tickSeconds = SCHEDULER_TICK_SECONDS);
+        SerialScheduler(const SerialScheduler&) = delete;
+        ~SerialScheduler();
+
+        EntryId add(
+            const SerialProcessor::SharedPtr& processor,
+            const SerialFrameId& frameId,
+            double periodSeconds,
+            double phaseSeconds = 0,
+            int priority = 0);
+        
+        void remove(EntryId id);
+
+        // sends everything due by now and returns the number of frames sent. Call it from a loop or a reactor timer,
+        // or let spin() call it. The sends happen outside the scheduler's lock
+        size_t runDue(const Time& now);
+
+        // when runDue() next has something to do. Sleeping until then is enough
+        Time nextWake(void);
+
+        // sleeps until each deadline and sends, until stop() is called from any thread. A stop() that comes before
+        // spin() starts makes it return right away. Each stop() ends one spin()
+        void spin(void);
+        void stop(void);
+
+        SchedulerStats stats(EntryId id);
+        SchedulerStats stats(void);
+        Time origin(void) const;
+
+        private:
+        struct Accumulator
+        {
+            SchedulerStats stats;
+            double sumSquares = 0; // of differences from the mean
+
+            void add(double lateness, uint64_t missed);
+        };
+
+        struct Entry
+        {
+            SerialProcessor::SharedPtr processor;
+            SerialFrameId frameId;
+            int64_t
+                deadlineNs, // next deadline, since the origin
+                periodNs;
+            
+            int priority;
+            Accumulator accumulator;
+        };
+
+        void insert(EntryId id, int64_t dueTick);
+        void cascade(int64_t tick);
+        int64_t dueTick(int64_t deadlineNs) const;
+        int64_t nanosecondsSinceOrigin(const Time& time) const;
+
+        const Time _origin;
+        const int64_t _tickNs;
+        int64_t _currentTick; // next tick to process
+        EntryId _nextId;
+        map<EntryId, Entry> _entries;
+        vector<vector<EntryId>> _slots; // every level of the wheel, back to back
+        Accumulator _total;
+        bool _stopRequested;
+        std::mutex _lock;
+        std::condition_variable _wake;
+    };
+
+    #if defined(USE_LINUX)
+    /**
+     * Drives many SerialProcessors from one thread. Each processor's transceiver handle is registered
+     * with epoll, and update() is only called when the transceiver has data. Links are level-triggered
+     * and get one update() per wake, so a busy link cannot starve the others. Periodic callbacks (for
+     * example, sends) can be scheduled on the same thread with addTimer().
+     */
+    class SERLIB_API SerialReactor
+    {
+        public:
+        typedef std::shared_ptr<SerialReactor> SharedPtr;
+        typedef std::unique_ptr<SerialReactor> UniquePtr;
+        typedef std::function<void(const Time&)> TimerCallback;
+        typedef int TimerId;
+
+        SerialReactor();
+        SerialReactor(const SerialReactor&) = delete;
+        ~SerialReactor();
+
+        void addProcessor(const SerialProcessor::SharedPtr& processor);
+        void removeProcessor(const SerialProcessor::SharedPtr& processor);
+        TimerId addTimer(double periodSeconds, const TimerCallback& callback);
+        void removeTimer(TimerId timer);
+
+        // waits up to timeoutSeconds (forever if negative) for events and handles them. Returns the number handled
+        size_t spinOnce(double timeoutSeconds);
+
+        // handles events until stop() is called. stop() can be called from any thread, also before spin() starts, in
+        // which case spin() returns right away. Each stop() ends one spin()
+        void spin();
+        void stop();
+
+        private:
+        struct Registration
+        {
+            int fd;
+            SerialProcessor::SharedPtr processor;
+            TimerCallback timerCallback;
+        };
+
+        uint64_t addRegistration(int fd, const Registration& registration);
+        void removeRegistration(uint64_t key);
+
+        int
+            _epoll,
+            _wakeEvent;
+        
+        std::atomic<bool> _stopRequested;
+        uint64_t _nextKey;
+        map<uint64_t, Registration> _registrations;
+        mutex _registrationsLock;
     };
+    #endif
 
     #if defined(USE_ROS)
     class SerlibRosNode : public rclcpp::Node
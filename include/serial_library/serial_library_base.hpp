@@ -30,16 +30,23 @@
 #include <stdbool.h>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <list>
+#include <deque>
 #include <vector>
 #include <set>
 #include <cstring>
 #include <csignal>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <future>
+#include <atomic>
 #include <memory>
 #include <functional>
 #include <algorithm>
+#include <type_traits>
 
 
 //
@@ -47,6 +54,21 @@
 //
 #define MAX_DATA_BYTES 64
 #define PROCESSOR_BUFFER_SIZE 4096
+#define MAX_IO_VECS 16
+#define MAX_PACKET_BATCH 64
+#define INTRA_PROCESS_CHANNEL_CAPACITY (1 << 16)
+#define INTRA_PROCESS_SEND_TIMEOUT_SECONDS 1.0
+#define SCHEDULER_TICK_SECONDS 0.0001
+
+// clock behind Time. SYSTEM is wall time and jumps when NTP steps it. STEADY never goes backwards. TSC is steady and
+// cheaper to read, see TscClock. Set through the SERLIB_CLOCK cmake option so the library and its users agree
+#define SERLIB_CLOCK_SYSTEM 0
+#define SERLIB_CLOCK_STEADY 1
+#define SERLIB_CLOCK_TSC 2
+
+#if !defined(SERLIB_CLOCK)
+#define SERLIB_CLOCK SERLIB_CLOCK_SYSTEM
+#endif
 
 namespace serial_library
 {
@@ -58,7 +80,42 @@ namespace serial_library
     typedef int SerialFieldId;
     typedef uint16_t Checksum;
 
-    typedef std::chrono::time_point<std::chrono::system_clock> Time;
+    /**
+     * Steady clock read from the cpu's timestamp counter. Ticks are turned into nanoseconds on steady_clock's timeline
+     * with a multiply and a shift, using a calibration against steady_clock taken the first time the clock is read.
+     * CPUs without an invariant counter fall back to steady_clock.
+     */
+    struct SERLIB_API TscClock
+    {
+        typedef std::chrono::nanoseconds duration;
+        typedef duration::rep rep;
+        typedef duration::period period;
+        typedef std::chrono::time_point<TscClock> time_point;
+        static constexpr bool is_steady = true;
+
+        struct Calibration
+        {
+            bool usable;
+            uint64_t baseTicks;
+            int64_t baseNanoseconds;
+            uint64_t multiplier; // nanoseconds per tick, scaled by 2^shift
+            unsigned int shift;
+        };
+
+        static const Calibration& calibration(void);
+        static uint64_t ticks(void);
+        static time_point now(void);
+    };
+
+    #if SERLIB_CLOCK == SERLIB_CLOCK_STEADY
+    typedef std::chrono::steady_clock Clock;
+    #elif SERLIB_CLOCK == SERLIB_CLOCK_TSC
+    typedef TscClock Clock;
+    #else
+    typedef std::chrono::system_clock Clock;
+    #endif
+
+    typedef std::chrono::time_point<Clock> Time;
     typedef std::string string;
     typedef std::mutex mutex;
 
@@ -85,7 +142,41 @@ namespace serial_library
     
     inline Time curtime()
     {
-        return std::chrono::system_clock::now();
+        return Clock::now();
+    }
+
+    // moves a time point to another clock. TscClock shares steady_clock's timeline, so converting between those two is
+    // exact. Other pairs are converted by reading both clocks, and are off by however far the clocks drifted (or
+    // were stepped) apart since t. Time() means "unknown" in the library, so check for it before converting
+    template<typename DstClock, typename SrcClock, typename Duration>
+    inline typename DstClock::time_point convertTime(const std::chrono::time_point<SrcClock, Duration>& t)
+    {
+        typedef typename DstClock::duration DstDuration;
+        if constexpr(std::is_same<DstClock, SrcClock>::value)
+        {
+            return std::chrono::time_point_cast<DstDuration>(t);
+        } else if constexpr(
+            (std::is_same<DstClock, TscClock>::value && std::is_same<SrcClock, std::chrono::steady_clock>::value) ||
+            (std::is_same<DstClock, std::chrono::steady_clock>::value && std::is_same<SrcClock, TscClock>::value))
+        {
+            return typename DstClock::time_point(std::chrono::duration_cast<DstDuration>(t.time_since_epoch()));
+        } else
+        {
+            typename DstClock::time_point dstNow = DstClock::now();
+            auto srcNow = SrcClock::now();
+            return dstNow + std::chrono::duration_cast<DstDuration>(t - srcNow);
+        }
+    }
+
+    // kernel timestamps and other wall clock times into Time, and back
+    inline Time fromSystemTime(const std::chrono::system_clock::time_point& t)
+    {
+        return convertTime<Clock>(t);
+    }
+
+    inline std::chrono::system_clock::time_point toSystemTime(const Time& t)
+    {
+        return convertTime<std::chrono::system_clock>(t);
     }
 
     template<typename InputIterator, typename T>
@@ -177,6 +268,12 @@ namespace serial_library
     #define FIELD_CHECKSUM FIELD_FRAME - 1
     #define FIELD_TERM FIELD_CHECKSUM - 1
 
+    // stands in for "no field", for example a request that is matched to its response by frame id alone
+    #define FIELD_NONE -1
+
+    // set on the frame id of a delta-encoded frame. frames using delta encoding must have ids below this value
+    #define DELTA_FRAME_FLAG 0x80
+
     //describes the fields held by a serial frame. Each frame represents 8 bits.
     typedef vector<SerialFieldId> SerialFrame;
     typedef map<SerialFrameId, SerialFrame> SerialFramesMap;
@@ -231,6 +328,27 @@ namespace serial_library
         SerialDataStamped data;
     };
 
+    // pieces of a scatter-gather transfer, see SerialTransceiver::sendv() and SerialTransceiver::recvv()
+    struct SERLIB_API SerialIoVec
+    {
+        char *data;
+        size_t numData;
+    };
+
+    struct SERLIB_API SerialConstIoVec
+    {
+        const char *data;
+        size_t numData;
+    };
+
+    // where one message landed in a SerialTransceiver::recvPackets() buffer
+    struct SERLIB_API SerialPacketInfo
+    {
+        size_t offset;
+        size_t length;
+        Time timestamp; // when the message arrived, if the transceiver knows. Left at Time() (the epoch) otherwise
+    };
+
     typedef map<SerialFieldId, SerialDataStamped> SerialValuesMap;
     typedef NewMessageFunctionTemplate<SerialValuesMap> NewMsgFunc;
 }
@@ -0,0 +1,179 @@
+#include "serial_library/serial_library.hpp"
+
+//
+// Source file for the broadcast variant of intra-process communication.
+// This encapsulates both the IntraProcessBroadcastChannel and IntraProcessBroadcastTransceiver classes.
+//
+
+namespace serial_library
+{
+    static uint64_t broadcastCapacity(size_t capacity)
+    {
+        uint64_t result = 1;
+        while(result < capacity)
+        {
+            result <<= 1;
+        }
+
+        return result;
+    }
+
+    //
+    // INTRA-PROCESS BROADCAST CHANNEL
+    //
+
+    IntraProcessBroadcastChannel::IntraProcessBroadcastChannel(size_t capacity, BroadcastLapPolicy lapPolicy)
+    : _lapPolicy(lapPolicy),
+      _data(broadcastCapacity(capacity)),
+      _mask(_data.size() - 1),
+      _reserveIndex(0),
+      _writeIndex(0)
+    { }
+
+
+    void IntraProcessBroadcastChannel::send(const char *data, size_t numData)
+    {
+        if(numData > _data.size())
+        {
+            SERLIB_LOG_ERROR("%d bytes do not fit in a broadcast channel of %d bytes, dropping them", (int) numData, (int) _data.size());
+            return;
+        }
+
+        //announce which bytes are about to be overwritten before overwriting them
+        uint64_t index = _writeIndex.load(std::memory_order_relaxed);
+        _reserveIndex.store(index + numData, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        size_t
+            offset = index & _mask,
+            first = std::min(numData, (size_t) (_data.size() - offset));
+        
+        memcpy(&_data[offset], data, first);
+        memcpy(_data.data(), data + first, numData - first);
+        _writeIndex.store(index + numData, std::memory_order_release);
+    }
+
+
+    std::shared_ptr<IntraProcessBroadcastTransceiver> IntraProcessBroadcastChannel::subscribe()
+    {
+        return std::make_shared<IntraProcessBroadcastTransceiver>(shared_from_this());
+    }
+
+
+    size_t IntraProcessBroadcastChannel::read(uint64_t& cursor, char *data, size_t numData, uint64_t& lostBytes, bool& disconnected) const
+    {
+        const uint64_t capacity = _data.size();
+        while(!disconnected)
+        {
+            uint64_t 
+                written = _writeIndex.load(std::memory_order_acquire),
+                n = std::min(written - cursor, (uint64_t) numData);
+            
+            if(written - cursor <= capacity)
+            {
+                if(n == 0)
+                {
+                    return 0;
+                }
+
+                size_t
+                    offset = cursor & _mask,
+                    first = std::min((size_t) n, (size_t) (capacity - offset));
+                
+                memcpy(data, &_data[offset], first);
+                memcpy(data + first, _data.data(), n - first);
+
+                //the copy is only good if the writer did not start overwriting it in the meantime
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(_reserveIndex.load(std::memory_order_relaxed) - cursor <= capacity)
+                {
+                    cursor += n;
+                    return n;
+                }
+            }
+
+            //lapped by the writer
+            uint64_t 
+                reserved = _reserveIndex.load(std::memory_order_acquire),
+                resumeAt = cursor;
+            
+            switch(_lapPolicy)
+            {
+                case LAP_SKIP_TO_OLDEST:
+                    resumeAt = reserved - capacity;
+                    break;
+                case LAP_SKIP_TO_NEWEST:
+                    resumeAt = reserved;
+                    break;
+                case LAP_DISCONNECT:
+                    disconnected = true;
+                    break;
+            }
+
+            if(resumeAt > cursor)
+            {
+                lostBytes += resumeAt - cursor;
+                cursor = resumeAt;
+            }
+        }
+
+        return 0;
+    }
+
+    //
+    // INTRA-PROCESS BROADCAST TRANSCEIVER
+    //
+
+    IntraProcessBroadcastTransceiver::IntraProcessBroadcastTransceiver(const IntraProcessBroadcastChannel::SharedPtr& channel, bool publisher)
+    : _channel(channel),
+      _publisher(publisher),
+      _cursor(channel->_writeIndex.load(std::memory_order_acquire)),
+      _lostBytes(0),
+      _disconnected(false)
+    { }
+
+
+    bool IntraProcessBroadcastTransceiver::init(void)
+    {
+        return true;
+    }
+
+
+    void IntraProcessBroadcastTransceiver::send(const char *data, size_t numData)
+    {
+        if(!_publisher)
+        {
+            SERLIB_LOG_DEBUG("Subscribers cannot send to a broadcast channel, dropping %d bytes", (int) numData);
+            return;
+        }
+
+        _channel->send(data, numData);
+    }
+
+
+    size_t IntraProcessBroadcastTransceiver::recv(char *data, size_t numData)
+    {
+        if(_publisher)
+        {
+            return 0;
+        }
+
+        return _channel->read(_cursor, data, numData, _lostBytes, _disconnected);
+    }
+
+
+    void IntraProcessBroadcastTransceiver::deinit(void)
+    { }
+
+
+    uint64_t IntraProcessBroadcastTransceiver::lostBytes(void) const
+    {
+        return _lostBytes;
+    }
+
+
+    bool IntraProcessBroadcastTransceiver::disconnected(void) const
+    {
+        return _disconnected;
+    }
+}
@@ -1,5 +1,9 @@
 #include "serial_library/serial_library.hpp"
 
+#if defined(USE_LINUX)
+#include <sys/eventfd.h>
+#endif
+
 //
 // Source file for everything intra-process communication.
 // This encapsulates both the IntraProcessChannel and IntraProcessTransceiver classes.
@@ -11,6 +15,45 @@ namespace serial_library
     // INTRA-PROCESS CHANNEL
     //
 
+    IntraProcessChannel::IntraProcessChannel(size_t capacity, IntraProcessOverflowPolicy overflowPolicy, double recvTimeoutSeconds, double sendTimeoutSeconds)
+    : _overflowPolicy(overflowPolicy),
+      _recvTimeoutSeconds(recvTimeoutSeconds),
+      _sendTimeoutSeconds(sendTimeoutSeconds),
+      _event(INVALID_NATIVE_HANDLE),
+      _droppedBytes(0)
+    {
+        //the ring needs 64-byte aligned memory
+        size_t regionLen = SpscByteRing::regionSize(capacity);
+        _storage.resize(regionLen + 64);
+        void *region = _storage.data();
+        size_t space = _storage.size();
+        if(!std::align(64, regionLen, region, space) || !_ring.attach(region, regionLen, true, capacity))
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("Could not set up ring for intra-process channel");
+        }
+
+        #if defined(USE_LINUX)
+        _event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(_event < 0)
+        {
+            SERLIB_LOG_ERROR("eventfd() failed, channel will not signal readiness: %s", strerror(errno));
+            _event = INVALID_NATIVE_HANDLE;
+        }
+        #endif
+    }
+
+
+    IntraProcessChannel::~IntraProcessChannel()
+    {
+        #if defined(USE_LINUX)
+        if(_event != INVALID_NATIVE_HANDLE)
+        {
+            close(_event);
+        }
+        #endif
+    }
+
+
     void IntraProcessChannel::setPartner(const std::shared_ptr<IntraProcessChannel>& partner)
     {
         this->_partner = partner;
@@ -34,22 +77,107 @@ namespace serial_library
 
     size_t IntraProcessChannel::recv(char *data, size_t numData)
     {
-        size_t
-            available = _data.size(),
-            n = (available > numData ? numData : available);
+        if(_recvTimeoutSeconds != 0 && _ring.readable() == 0)
+        {
+            _ring.waitReadable(_recvTimeoutSeconds);
+        }
 
-        memcpy(data, _data.data(), n);
+        size_t n = _ring.read(data, numData);
 
-        //now clear as much data from _data as was received
-        _data.erase(_data.begin(), _data.begin() + n);
+        #if defined(USE_LINUX)
+        //drained, so the channel is no longer readable. data that arrived while draining signals again
+        if(_ring.readable() == 0 && _event != INVALID_NATIVE_HANDLE)
+        {
+            eventfd_t count;
+            eventfd_read(_event, &count);
+            if(_ring.readable() > 0)
+            {
+                eventfd_write(_event, 1);
+            }
+        }
+        #endif
 
         return n;
     }
 
 
+    NativeHandle IntraProcessChannel::nativeHandle() const
+    {
+        return _event;
+    }
+
+
+    uint64_t IntraProcessChannel::droppedBytes() const
+    {
+        return _droppedBytes;
+    }
+
+
     void IntraProcessChannel::injectData(const char *data, size_t numData)
     {
-        _data.insert(_data.end(), data, data + numData);
+        if(numData == 0)
+        {
+            return;
+        }
+
+        if(numData > _ring.capacity())
+        {
+            SERLIB_LOG_ERROR("%d bytes do not fit in a channel of %d bytes, dropping them", (int) numData, (int) _ring.capacity());
+            _droppedBytes += numData;
+            return;
+        }
+
+        if(!_ring.write(data, numData))
+        {
+            switch(_overflowPolicy)
+            {
+                case OVERFLOW_BLOCK:
+                {
+                    //bounded so that a reader which stopped reading cannot hang the sender
+                    Time deadline = curtime() + std::chrono::microseconds((long) (_sendTimeoutSeconds * 1000000));
+                    while(!_ring.write(data, numData))
+                    {
+                        double remaining = -1;
+                        if(_sendTimeoutSeconds >= 0)
+                        {
+                            remaining = std::chrono::duration<double>(deadline - curtime()).count();
+                            if(remaining <= 0)
+                            {
+                                SERLIB_LOG_ERROR("Reader made no room for %d bytes in %f seconds, dropping them", (int) numData, _sendTimeoutSeconds);
+                                _droppedBytes += numData;
+                                return;
+                            }
+                        }
+
+                        _ring.waitWritable(numData, remaining);
+                    }
+                    
+                    break;
+                }
+                case OVERFLOW_DROP_OLDEST:
+                    //the reader may be taking data at the same time, so more than needed may be gone. writable() can
+                    //then already cover numData, in which case nothing is dropped and the write is tried again
+                    while(!_ring.write(data, numData))
+                    {
+                        size_t writable = _ring.writable();
+                        _droppedBytes += _ring.discardOldest(writable >= numData ? 0 : numData - writable);
+                    }
+
+                    break;
+                case OVERFLOW_DROP_NEWEST:
+                    //dropping is what this policy is for, so it is counted rather than logged as an error
+                    SERLIB_LOG_DEBUG("Channel full, dropping %d bytes", (int) numData);
+                    _droppedBytes += numData;
+                    return;
+            }
+        }
+
+        #if defined(USE_LINUX)
+        if(_event != INVALID_NATIVE_HANDLE)
+        {
+            eventfd_write(_event, 1);
+        }
+        #endif
     }
 
 
@@ -93,4 +221,16 @@ namespace serial_library
 
     void IntraProcessTransceiver::deinit(void)
     { }
+
+
+    unsigned int IntraProcessTransceiver::capabilities(void) const
+    {
+        return (_channel->nativeHandle() != INVALID_NATIVE_HANDLE ? TRANSCEIVER_CAP_NATIVE_HANDLE : TRANSCEIVER_CAP_NONE);
+    }
+
+
+    NativeHandle IntraProcessTransceiver::nativeHandle(void) const
+    {
+        return _channel->nativeHandle();
+    }
 }
@@ -34,6 +34,26 @@ namespace serial_library  {
         sendUDP.deinit();
     }
 
+    void LinuxDualUDPTransceiver::sendv(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        sendUDP.sendv(vecs, numVecs);
+    }
+
+    size_t LinuxDualUDPTransceiver::recvv(const SerialIoVec *vecs, size_t numVecs)
+    {
+        return recvUDP.recvv(vecs, numVecs);
+    }
+
+    unsigned int LinuxDualUDPTransceiver::capabilities(void) const
+    {
+        return recvUDP.capabilities() & sendUDP.capabilities();
+    }
+
+    NativeHandle LinuxDualUDPTransceiver::nativeHandle(void) const
+    {
+        return recvUDP.nativeHandle();
+    }
+
 }
 
 #endif
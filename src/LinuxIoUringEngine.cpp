@@ -0,0 +1,613 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// io_uring engine using the raw syscalls: https://man7.org/linux/man-pages/man7/io_uring.7.html
+
+#define IO_URING_BUFFER_GROUP 0
+#define IO_URING_KIND_SHIFT 56
+#define IO_URING_KIND_RECV 1ULL
+#define IO_URING_KIND_SEND 2ULL
+#define IO_URING_KIND_CANCEL 3ULL
+#define IO_URING_SHUTDOWN_TIMEOUT_MS 1000
+
+namespace serial_library
+{
+    static int ioUringSetup(unsigned int entries, io_uring_params *params)
+    {
+        return (int) syscall(__NR_io_uring_setup, entries, params);
+    }
+
+
+    static int ioUringEnter(int ring, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+    {
+        return (int) syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0);
+    }
+
+
+    static int ioUringRegister(int ring, unsigned int opcode, void *arg, unsigned int numArgs)
+    {
+        return (int) syscall(__NR_io_uring_register, ring, opcode, arg, numArgs);
+    }
+
+
+    static uint64_t userData(uint64_t kind, uint64_t id)
+    {
+        return (kind << IO_URING_KIND_SHIFT) | id;
+    }
+
+
+    LinuxIoUringEngine::LinuxIoUringEngine(unsigned int queueDepth, unsigned int numBuffers, size_t bufferSize)
+     : _ring(-1),
+       _numBuffers(numBuffers),
+       _sqEntries(0),
+       _toSubmit(0),
+       _bufferSize(bufferSize),
+       _sqRingSize(0),
+       _cqRingSize(0),
+       _sqesSize(0),
+       _bufRingSize(0),
+       _sqRing(MAP_FAILED),
+       _cqRing(MAP_FAILED),
+       _sqes(MAP_FAILED),
+       _bufRing(MAP_FAILED),
+       _nextLink(1),
+       _nextSend(1),
+       _outstandingRecvs(0)
+    {
+        SERIAL_LIB_ASSERT(numBuffers > 0 && numBuffers <= 32768 && (numBuffers & (numBuffers - 1)) == 0, "Number of io_uring buffers must be a power of two no greater than 32768");
+
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        _ring = ioUringSetup(queueDepth, &params);
+        if(_ring < 0)
+        {
+            SERLIB_LOG_DEBUG("io_uring_setup() failed, falling back to regular syscalls: %s", strerror(errno));
+            _ring = -1;
+            return;
+        }
+
+        _sqEntries = params.sq_entries;
+        _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if(singleMmap)
+        {
+            _sqRingSize = std::max(_sqRingSize, _cqRingSize);
+            _cqRingSize = _sqRingSize;
+        }
+
+        _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQ_RING);
+        _cqRing = (singleMmap ? _sqRing : mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_CQ_RING));
+        _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQES);
+
+        //buffer ring the kernel picks receive buffers from
+        _bufRingSize = numBuffers * sizeof(io_uring_buf);
+        _bufRing = mmap(nullptr, _bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if(_sqRing == MAP_FAILED || _cqRing == MAP_FAILED || _sqes == MAP_FAILED || _bufRing == MAP_FAILED)
+        {
+            SERLIB_LOG_ERROR("Failed to map io_uring rings, falling back to regular syscalls: %s", strerror(errno));
+            unmap();
+            return;
+        }
+
+        char *sqRing = (char *) _sqRing;
+        _sqHead = (unsigned *) (sqRing + params.sq_off.head);
+        _sqTail = (unsigned *) (sqRing + params.sq_off.tail);
+        _sqMask = (unsigned *) (sqRing + params.sq_off.ring_mask);
+        _sqArray = (unsigned *) (sqRing + params.sq_off.array);
+
+        char *cqRing = (char *) _cqRing;
+        _cqHead = (unsigned *) (cqRing + params.cq_off.head);
+        _cqTail = (unsigned *) (cqRing + params.cq_off.tail);
+        _cqMask = (unsigned *) (cqRing + params.cq_off.ring_mask);
+        _cqes = cqRing + params.cq_off.cqes;
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (uint64_t) _bufRing;
+        reg.ring_entries = numBuffers;
+        reg.bgid = IO_URING_BUFFER_GROUP;
+        if(ioUringRegister(_ring, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            SERLIB_LOG_DEBUG("Failed to register io_uring buffer ring, falling back to regular syscalls: %s", strerror(errno));
+            unmap();
+            return;
+        }
+
+        _buffers.resize(numBuffers * bufferSize);
+        for(unsigned short i = 0; i < numBuffers; i++)
+        {
+            recycleBuffer(i);
+        }
+    }
+
+
+    LinuxIoUringEngine::~LinuxIoUringEngine()
+    {
+        if(_ring >= 0 && _sqes != MAP_FAILED)
+        {
+            //cancel everything and wait for the kernel to let go of the buffers before they are freed
+            _lock.lock();
+            _links.clear();
+            io_uring_sqe *sqe = (io_uring_sqe *) nextSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+            sqe->user_data = userData(IO_URING_KIND_CANCEL, 0);
+            submitLocked();
+            _lock.unlock();
+
+            Time deadline = curtime() + std::chrono::milliseconds(IO_URING_SHUTDOWN_TIMEOUT_MS);
+            while((_outstandingRecvs > 0 || !_sends.empty()) && curtime() < deadline)
+            {
+                poll(0.01);
+            }
+        }
+
+        unmap();
+    }
+
+
+    bool LinuxIoUringEngine::available() const
+    {
+        return _ring >= 0;
+    }
+
+
+    size_t LinuxIoUringEngine::flush()
+    {
+        if(!available())
+        {
+            return 0;
+        }
+
+        std::lock_guard<mutex> lock(_lock);
+        return submitLocked();
+    }
+
+
+    size_t LinuxIoUringEngine::poll(double timeoutSeconds)
+    {
+        if(!available())
+        {
+            return 0;
+        }
+
+        {
+            std::lock_guard<mutex> lock(_lock);
+            submitLocked();
+            size_t handled = reapLocked();
+            if(handled > 0 || timeoutSeconds == 0)
+            {
+                return handled;
+            }
+        }
+
+        //wait without holding the lock so that other links can keep queueing
+        pollfd pfd;
+        pfd.fd = _ring;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        timespec timeout;
+        timeout.tv_sec = (time_t) timeoutSeconds;
+        timeout.tv_nsec = (long) ((timeoutSeconds - (double) timeout.tv_sec) * 1000000000);
+        if(ppoll(&pfd, 1, (timeoutSeconds < 0 ? nullptr : &timeout), nullptr) < 0 && errno != EINTR)
+        {
+            SERLIB_LOG_ERROR("ppoll() on io_uring failed: %s", strerror(errno));
+        }
+
+        std::lock_guard<mutex> lock(_lock);
+        return reapLocked();
+    }
+
+
+    NativeHandle LinuxIoUringEngine::nativeHandle() const
+    {
+        return _ring;
+    }
+
+
+    uint64_t LinuxIoUringEngine::attach(int fd)
+    {
+        struct stat info;
+        bool isSocket = fstat(fd, &info) == 0 && S_ISSOCK(info.st_mode);
+        bool isStream = true;
+        if(isSocket)
+        {
+            int type = 0;
+            socklen_t typeLen = sizeof(type);
+            if(getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &typeLen) == 0)
+            {
+                isStream = (type == SOCK_STREAM);
+            }
+        }
+
+        std::lock_guard<mutex> lock(_lock);
+        uint64_t id = _nextLink++;
+        Link& link = _links[id];
+        link.fd = fd;
+        link.isSocket = isSocket;
+        link.isStream = isStream;
+        link.multishot = isSocket;
+        link.recvPosted = false;
+        link.closed = false;
+        link.sendInFlight = false;
+        link.receivedOffset = 0;
+        submitLocked();
+        return id;
+    }
+
+
+    void LinuxIoUringEngine::detach(uint64_t linkId)
+    {
+        std::lock_guard<mutex> lock(_lock);
+        auto it = _links.find(linkId);
+        if(it == _links.end())
+        {
+            return;
+        }
+
+        //get remaining sends out, and the posted receive cancelled, before the caller closes the fd
+        submitLocked();
+        if(it->second.recvPosted)
+        {
+            io_uring_sqe *sqe = (io_uring_sqe *) nextSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = userData(IO_URING_KIND_RECV, linkId);
+            sqe->user_data = userData(IO_URING_KIND_CANCEL, linkId);
+        }
+
+        _links.erase(it);
+        submitLocked();
+    }
+
+
+    void LinuxIoUringEngine::queueSend(uint64_t linkId, const char *data, size_t numData)
+    {
+        std::lock_guard<mutex> lock(_lock);
+        auto it = _links.find(linkId);
+        if(it == _links.end())
+        {
+            return;
+        }
+
+        if(it->second.isStream)
+        {
+            //coalesced with the link's other sends. only one write per stream is in flight so that order is kept
+            it->second.outbound.insert(it->second.outbound.end(), data, data + numData);
+            return;
+        }
+
+        //datagrams keep their boundaries, so they each get a submission
+        uint64_t sendId = _nextSend++;
+        Send& send = _sends[sendId];
+        send.link = linkId;
+        send.data.assign(data, data + numData);
+        send.offset = 0;
+        prepSend(sendId, send);
+    }
+
+
+    size_t LinuxIoUringEngine::takeReceived(uint64_t linkId, char *data, size_t numData)
+    {
+        std::lock_guard<mutex> lock(_lock);
+        auto it = _links.find(linkId);
+        if(it == _links.end())
+        {
+            return 0;
+        }
+
+        Link& link = it->second;
+        if(!link.isStream)
+        {
+            //one datagram per call, truncated like recv() would
+            if(link.received.empty())
+            {
+                return 0;
+            }
+
+            size_t taken = std::min(numData, link.received.front().size());
+            memcpy(data, link.received.front().data(), taken);
+            link.received.pop_front();
+            return taken;
+        }
+
+        size_t taken = 0;
+        while(taken < numData && !link.received.empty())
+        {
+            const vector<char>& chunk = link.received.front();
+            size_t numCopy = std::min(numData - taken, chunk.size() - link.receivedOffset);
+            memcpy(data + taken, chunk.data() + link.receivedOffset, numCopy);
+            taken += numCopy;
+            link.receivedOffset += numCopy;
+            if(link.receivedOffset == chunk.size())
+            {
+                link.received.pop_front();
+                link.receivedOffset = 0;
+            }
+        }
+
+        return taken;
+    }
+
+
+    bool LinuxIoUringEngine::hasReceived(uint64_t linkId)
+    {
+        std::lock_guard<mutex> lock(_lock);
+        auto it = _links.find(linkId);
+        return it != _links.end() && !it->second.received.empty();
+    }
+
+
+    void *LinuxIoUringEngine::nextSqe()
+    {
+        unsigned tail = *_sqTail;
+        if(tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries)
+        {
+            //queue is full, hand what is there to the kernel first
+            int ret = ioUringEnter(_ring, _toSubmit, 0, 0);
+            if(ret > 0)
+            {
+                _toSubmit -= ret;
+            }
+        }
+
+        unsigned index = tail & *_sqMask;
+        io_uring_sqe *sqe = ((io_uring_sqe *) _sqes) + index;
+        memset(sqe, 0, sizeof(*sqe));
+        _sqArray[index] = index;
+        __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+        _toSubmit++;
+        return sqe;
+    }
+
+
+    void LinuxIoUringEngine::prepRecv(uint64_t linkId, const Link& link)
+    {
+        io_uring_sqe *sqe = (io_uring_sqe *) nextSqe();
+        sqe->fd = link.fd;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = IO_URING_BUFFER_GROUP;
+        sqe->user_data = userData(IO_URING_KIND_RECV, linkId);
+        if(link.isSocket)
+        {
+            sqe->opcode = IORING_OP_RECV;
+            if(link.multishot)
+            {
+                //stays posted, producing a completion per receive until it fails or is cancelled
+                sqe->ioprio = IORING_RECV_MULTISHOT;
+            } else
+            {
+                sqe->len = _bufferSize;
+            }
+        } else
+        {
+            sqe->opcode = IORING_OP_READ;
+            sqe->len = _bufferSize;
+            sqe->off = (uint64_t) -1;
+        }
+
+        _outstandingRecvs++;
+    }
+
+
+    void LinuxIoUringEngine::prepSend(uint64_t sendId, const Send& send)
+    {
+        auto it = _links.find(send.link);
+        if(it == _links.end())
+        {
+            return;
+        }
+
+        bool isSocket = it->second.isSocket;
+        io_uring_sqe *sqe = (io_uring_sqe *) nextSqe();
+        sqe->opcode = (isSocket ? IORING_OP_SEND : IORING_OP_WRITE);
+        sqe->fd = it->second.fd;
+        sqe->addr = (uint64_t) (send.data.data() + send.offset);
+        sqe->len = send.data.size() - send.offset;
+        sqe->off = (isSocket ? 0 : (uint64_t) -1);
+        sqe->user_data = userData(IO_URING_KIND_SEND, sendId);
+    }
+
+
+    size_t LinuxIoUringEngine::submitLocked()
+    {
+        for(auto it = _links.begin(); it != _links.end(); it++)
+        {
+            Link& link = it->second;
+            if(!link.recvPosted && !link.closed)
+            {
+                prepRecv(it->first, link);
+                link.recvPosted = true;
+            }
+
+            if(link.isStream && !link.sendInFlight && !link.outbound.empty())
+            {
+                uint64_t sendId = _nextSend++;
+                Send& send = _sends[sendId];
+                send.link = it->first;
+                send.data.swap(link.outbound);
+                send.offset = 0;
+                prepSend(sendId, send);
+                link.sendInFlight = true;
+            }
+        }
+
+        if(_toSubmit == 0)
+        {
+            return 0;
+        }
+
+        int ret = ioUringEnter(_ring, _toSubmit, 0, 0);
+        if(ret < 0)
+        {
+            //anything not submitted stays queued for the next flush
+            if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                SERLIB_LOG_ERROR("io_uring_enter() failed: %s", strerror(errno));
+            }
+
+            return 0;
+        }
+
+        _toSubmit -= ret;
+        return ret;
+    }
+
+
+    size_t LinuxIoUringEngine::reapLocked()
+    {
+        size_t handled = 0;
+        unsigned
+            head = *_cqHead,
+            tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+
+        for(; head != tail; head++)
+        {
+            io_uring_cqe cqe = ((io_uring_cqe *) _cqes)[head & *_cqMask];
+            uint64_t
+                kind = cqe.user_data >> IO_URING_KIND_SHIFT,
+                id = cqe.user_data & ((1ULL << IO_URING_KIND_SHIFT) - 1);
+
+            handled++;
+            if(kind == IO_URING_KIND_RECV)
+            {
+                auto it = _links.find(id);
+                if(cqe.flags & IORING_CQE_F_BUFFER)
+                {
+                    unsigned short bufferId = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                    if(it != _links.end() && cqe.res > 0)
+                    {
+                        const char *buffer = _buffers.data() + bufferId * _bufferSize;
+                        it->second.received.emplace_back(buffer, buffer + cqe.res);
+                    }
+
+                    recycleBuffer(bufferId);
+                }
+
+                if(!(cqe.flags & IORING_CQE_F_MORE))
+                {
+                    _outstandingRecvs--;
+                }
+
+                if(it == _links.end())
+                {
+                    continue;
+                }
+
+                Link& link = it->second;
+                if(!(cqe.flags & IORING_CQE_F_MORE))
+                {
+                    //reposted by the next flush
+                    link.recvPosted = false;
+                }
+
+                if(cqe.res == -EINVAL && link.multishot)
+                {
+                    SERLIB_LOG_DEBUG("Multishot receive not supported, using single receives");
+                    link.multishot = false;
+                } else if(cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED && cqe.res != -EINTR && cqe.res != -EAGAIN)
+                {
+                    SERLIB_LOG_ERROR("io_uring receive failed: %s", strerror(-cqe.res));
+                    link.closed = true;
+                } else if(cqe.res == 0 && link.isSocket && link.isStream)
+                {
+                    SERLIB_LOG_DEBUG("io_uring receive reached end of stream");
+                    link.closed = true;
+                }
+            } else if(kind == IO_URING_KIND_SEND)
+            {
+                auto it = _sends.find(id);
+                if(it == _sends.end())
+                {
+                    continue;
+                }
+
+                Send& send = it->second;
+                auto linkIt = _links.find(send.link);
+                if(cqe.res < 0)
+                {
+                    SERLIB_LOG_ERROR("io_uring send failed: %s", strerror(-cqe.res));
+                } else
+                {
+                    send.offset += cqe.res;
+                    if(send.offset < send.data.size() && linkIt != _links.end())
+                    {
+                        //short write, send the rest
+                        prepSend(id, send);
+                        continue;
+                    }
+                }
+
+                if(linkIt != _links.end())
+                {
+                    linkIt->second.sendInFlight = false;
+                }
+
+                _sends.erase(it);
+            }
+        }
+
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+        return handled;
+    }
+
+
+    void LinuxIoUringEngine::unmap()
+    {
+        if(_bufRing != MAP_FAILED)
+        {
+            munmap(_bufRing, _bufRingSize);
+        }
+
+        if(_sqes != MAP_FAILED)
+        {
+            munmap(_sqes, _sqesSize);
+        }
+
+        if(_cqRing != MAP_FAILED && _cqRing != _sqRing)
+        {
+            munmap(_cqRing, _cqRingSize);
+        }
+
+        if(_sqRing != MAP_FAILED)
+        {
+            munmap(_sqRing, _sqRingSize);
+        }
+
+        if(_ring >= 0)
+        {
+            close(_ring);
+        }
+
+        _bufRing = _sqes = _cqRing = _sqRing = MAP_FAILED;
+        _ring = -1;
+    }
+
+
+    void LinuxIoUringEngine::recycleBuffer(unsigned short bufferId)
+    {
+        io_uring_buf *bufs = (io_uring_buf *) _bufRing;
+
+        //the ring tail overlays the reserved field of the first entry
+        unsigned short *tail = &bufs[0].resv;
+        unsigned short index = *tail;
+        io_uring_buf& buf = bufs[index & (_numBuffers - 1)];
+        buf.addr = (uint64_t) (_buffers.data() + bufferId * _bufferSize);
+        buf.len = _bufferSize;
+        buf.bid = bufferId;
+        __atomic_store_n(tail, (unsigned short) (index + 1), __ATOMIC_RELEASE);
+    }
+}
+
+#endif
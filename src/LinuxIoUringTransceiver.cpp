@@ -0,0 +1,118 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+namespace serial_library
+{
+    LinuxIoUringTransceiver::LinuxIoUringTransceiver(
+        const SerialTransceiver::SharedPtr& transceiver,
+        const LinuxIoUringEngine::SharedPtr& engine,
+        double recvTimeoutSeconds)
+    : _transceiver(transceiver),
+      _engine(engine),
+      _recvTimeoutSeconds(recvTimeoutSeconds),
+      _link(0),
+      _attached(false) { }
+
+
+    bool LinuxIoUringTransceiver::init(void)
+    {
+        if(!_transceiver->init())
+        {
+            return false;
+        }
+
+        NativeHandle handle = _transceiver->nativeHandle();
+        if(!_engine->available() || handle == INVALID_NATIVE_HANDLE)
+        {
+            SERLIB_LOG_DEBUG("io_uring not usable for this transceiver, using its own send() and recv()");
+            return true;
+        }
+
+        _link = _engine->attach(handle);
+        _attached = true;
+        return true;
+    }
+
+
+    void LinuxIoUringTransceiver::send(const char *data, size_t numData)
+    {
+        if(!usingEngine())
+        {
+            _transceiver->send(data, numData);
+            return;
+        }
+
+        _engine->queueSend(_link, data, numData);
+    }
+
+
+    size_t LinuxIoUringTransceiver::recv(char *data, size_t numData)
+    {
+        if(!usingEngine())
+        {
+            return _transceiver->recv(data, numData);
+        }
+
+        //flushes whatever was queued this tick and picks up new data
+        _engine->poll(_engine->hasReceived(_link) ? 0 : _recvTimeoutSeconds);
+        return _engine->takeReceived(_link, data, numData);
+    }
+
+
+    void LinuxIoUringTransceiver::deinit(void)
+    {
+        if(_attached)
+        {
+            _engine->detach(_link);
+            _attached = false;
+        }
+
+        _transceiver->deinit();
+    }
+
+
+    unsigned int LinuxIoUringTransceiver::capabilities(void) const
+    {
+        //data is consumed from the wrapped transceiver's handle by the engine, so it no longer signals readiness
+        return (usingEngine() ? (unsigned int) TRANSCEIVER_CAP_NONE : _transceiver->capabilities());
+    }
+
+
+    NativeHandle LinuxIoUringTransceiver::nativeHandle(void) const
+    {
+        return (usingEngine() ? INVALID_NATIVE_HANDLE : _transceiver->nativeHandle());
+    }
+
+
+    bool LinuxIoUringTransceiver::waitForData(double timeoutSeconds)
+    {
+        if(!usingEngine())
+        {
+            return _transceiver->waitForData(timeoutSeconds);
+        }
+
+        Time deadline = curtime() + std::chrono::microseconds((long) (timeoutSeconds * 1000000));
+        while(!_engine->hasReceived(_link))
+        {
+            Time now = curtime();
+            if(timeoutSeconds >= 0 && now >= deadline)
+            {
+                return false;
+            }
+
+            double remaining = (timeoutSeconds < 0 ? -1 : std::chrono::duration<double>(deadline - now).count());
+            _engine->poll(remaining);
+        }
+
+        return true;
+    }
+
+
+    bool LinuxIoUringTransceiver::usingEngine() const
+    {
+        return _attached;
+    }
+}
+
+#endif
@@ -2,8 +2,14 @@
 
 #if defined(USE_LINUX)
 
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
 // linux serial port implementation: https://blog.mbedded.ninja/programming/operating-systems/linux/linux-serial-ports-using-c-cpp/
 
+// how long send() waits for room in a full output buffer before giving up on the rest of the data
+#define SEND_STALL_TIMEOUT_MS 1000
+
 namespace serial_library
 {
 
@@ -15,8 +21,11 @@ namespace serial_library
         int mode,
         int bitsPerByte,
         bool twoStopBits,
-        bool parityBit)
+        bool parityBit,
+        const LinuxSerialTransceiverOptions& options)
           : fileName(fileName),
+            options(options),
+            characterTime(0),
             baud(baud),
             mode(mode),
             bitsPerByte(bitsPerByte),
@@ -63,12 +72,17 @@ namespace serial_library
         //configure stop bit
         config.c_cflag = (twoStopBits ? config.c_cflag | CSTOPB : config.c_cflag & ~CSTOPB);
 
-        //configure baud
-        cfsetspeed(&config, baud);
+        //configure baud. rates without a B* constant are set through termios2 once the rest is configured
+        bool customBaud = (cfsetspeed(&config, baud) < 0);
+        if(customBaud)
+        {
+            cfsetspeed(&config, B38400);
+        }
 
-        //configure system call settings vmin and vtime
-        config.c_cc[VMIN] = minimumBytes;
-        config.c_cc[VTIME] = maximumTimeout;
+        //configure system call settings vmin and vtime. polled reads must never block in read()
+        bool pollReads = (options.readTimeoutMicroseconds >= 0);
+        config.c_cc[VMIN] = (pollReads ? 0 : minimumBytes);
+        config.c_cc[VTIME] = (pollReads ? 0 : maximumTimeout);
         
         //other, assumed settings
         config.c_cflag &= ~CRTSCTS;                 // disable hardware flow control
@@ -87,7 +101,27 @@ namespace serial_library
             return false;
         }
 
+        if(customBaud && !setCustomBaud(file, baud))
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("Could not set baud rate " + std::to_string(baud) + ": " + string(strerror(errno)));
+            initialized = false;
+            return false;
+        }
+
+        //start bit, data bits, parity bit and stop bits at the rate the driver settled on
+        int 
+            actualBaud = getBaud(file),
+            dataBits = (bitsPerByte == CS5 ? 5 : bitsPerByte == CS6 ? 6 : bitsPerByte == CS7 ? 7 : 8),
+            bitsPerCharacter = 1 + dataBits + (parityBit ? 1 : 0) + (twoStopBits ? 2 : 1);
+        
+        characterTime = (actualBaud > 0 ? (double) bitsPerCharacter / actualBaud : 0);
         initialized = true;
+
+        if(options.lowLatency && !setLowLatency(true))
+        {
+            SERLIB_LOG_DEBUG("%s does not support low latency mode. Continuing setup", fileName.c_str());
+        }
+
         return true;
     }
 
@@ -96,20 +130,17 @@ namespace serial_library
     {
         if(initialized)
         {
-            ssize_t ret = write(file, data, numData);
-
-            if(ret < 0)
-            {
-                SERLIB_LOG_ERROR("Failed to send: %s", strerror(errno));
-            }
+            iovec iov;
+            iov.iov_base = (void *) data;
+            iov.iov_len = numData;
+            writeAll(&iov, 1);
         }
     }
 
 
     size_t LinuxSerialTransceiver::recv(char *data, size_t numData)
     {
-        memset(data, 0, numData);
-        if(initialized)
+        if(initialized && waitReadable())
         {
             ssize_t ret = read(file, data, numData);
             if(ret < 0)
@@ -132,6 +163,172 @@ namespace serial_library
             initialized = false;
         }
     }
+
+
+    void LinuxSerialTransceiver::sendv(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        iovec iovs[MAX_IO_VECS];
+        if(!toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            SerialTransceiver::sendv(vecs, numVecs);
+            return;
+        }
+
+        if(initialized)
+        {
+            writeAll(iovs, numVecs);
+        }
+    }
+
+
+    size_t LinuxSerialTransceiver::recvv(const SerialIoVec *vecs, size_t numVecs)
+    {
+        iovec iovs[MAX_IO_VECS];
+        if(!toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            return SerialTransceiver::recvv(vecs, numVecs);
+        }
+
+        if(initialized && waitReadable())
+        {
+            ssize_t ret = readv(file, iovs, numVecs);
+            if(ret < 0)
+            {
+                return 0;
+            }
+
+            return ret;
+        }
+
+        return 0;
+    }
+
+
+    size_t LinuxSerialTransceiver::recvPackets(char *data, size_t numData, SerialPacketInfo *packets, size_t maxPackets)
+    {
+        if(maxPackets == 0 || !initialized || !waitReadable())
+        {
+            return 0;
+        }
+
+        //polled reads know the bytes are there before reading them. blocking reads only know once read() returns.
+        //with a character time, readers count back from the stamp to each byte, so it has to be taken once the read
+        //is complete, or bytes that came in between the wake-up and the read would be dated twice too early
+        Time arrival = curtime();
+        ssize_t ret = read(file, data, numData);
+        if(ret <= 0)
+        {
+            return 0;
+        }
+
+        packets[0].offset = 0;
+        packets[0].length = ret;
+        packets[0].timestamp = (options.readTimeoutMicroseconds >= 0 && characterTime <= 0 ? arrival : curtime());
+        return 1;
+    }
+
+
+    unsigned int LinuxSerialTransceiver::capabilities(void) const
+    {
+        return TRANSCEIVER_CAP_VECTORED_IO | TRANSCEIVER_CAP_NATIVE_HANDLE;
+    }
+
+
+    NativeHandle LinuxSerialTransceiver::nativeHandle(void) const
+    {
+        return (initialized ? file : INVALID_NATIVE_HANDLE);
+    }
+
+
+    double LinuxSerialTransceiver::secondsPerByte(void) const
+    {
+        return characterTime;
+    }
+
+
+    bool LinuxSerialTransceiver::setLowLatency(bool enable)
+    {
+        serial_struct serial;
+        if(!initialized || ioctl(file, TIOCGSERIAL, &serial) < 0)
+        {
+            return false;
+        }
+
+        serial.flags = (enable ? serial.flags | ASYNC_LOW_LATENCY : serial.flags & ~ASYNC_LOW_LATENCY);
+        return ioctl(file, TIOCSSERIAL, &serial) == 0;
+    }
+
+
+    bool LinuxSerialTransceiver::waitReadable(void)
+    {
+        if(options.readTimeoutMicroseconds < 0)
+        {
+            //read() blocks according to VMIN and VTIME
+            return true;
+        }
+
+        pollfd pfd;
+        pfd.fd = file;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        timespec to;
+        to.tv_sec = options.readTimeoutMicroseconds / 1000000;
+        to.tv_nsec = (options.readTimeoutMicroseconds % 1000000) * 1000;
+        return ppoll(&pfd, 1, &to, nullptr) > 0;
+    }
+
+
+    bool LinuxSerialTransceiver::writeAll(iovec *iovs, size_t numIovs)
+    {
+        //write() can take only part of the data: when a signal interrupts it, or when the port is non-blocking and
+        //its output buffer fills up. keep going from where it stopped so that frames are not cut short on the wire
+        while(numIovs > 0)
+        {
+            ssize_t ret = writev(file, iovs, numIovs);
+            if(ret < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+
+                if(errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    pollfd pfd;
+                    pfd.fd = file;
+                    pfd.events = POLLOUT;
+                    pfd.revents = 0;
+                    if(poll(&pfd, 1, SEND_STALL_TIMEOUT_MS) > 0)
+                    {
+                        continue;
+                    }
+
+                    SERLIB_LOG_ERROR("Failed to send: output buffer of %s stayed full", fileName.c_str());
+                    return false;
+                }
+
+                SERLIB_LOG_ERROR("Failed to send: %s", strerror(errno));
+                return false;
+            }
+
+            size_t written = ret;
+            while(numIovs > 0 && written >= iovs->iov_len)
+            {
+                written -= iovs->iov_len;
+                iovs++;
+                numIovs--;
+            }
+
+            if(numIovs > 0)
+            {
+                iovs->iov_base = (char *) iovs->iov_base + written;
+                iovs->iov_len -= written;
+            }
+        }
+
+        return true;
+    }
 }
 
 #endif
@@ -0,0 +1,194 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// memfd: https://man7.org/linux/man-pages/man2/memfd_create.2.html
+
+namespace serial_library
+{
+    LinuxSharedMemoryTransceiver::LinuxSharedMemoryTransceiver(SharedMemoryWaitMode waitMode, size_t capacity, double recvTimeoutSeconds, double sendTimeoutSeconds)
+    : _capacity(capacity),
+      _waitMode(waitMode),
+      _recvTimeoutSeconds(recvTimeoutSeconds),
+      _sendTimeoutSeconds(sendTimeoutSeconds),
+      _isParent(true),
+      _fd(-1),
+      _region(nullptr),
+      _regionLen(0)
+    { }
+
+
+    LinuxSharedMemoryTransceiver::LinuxSharedMemoryTransceiver(int childFd, SharedMemoryWaitMode waitMode, double recvTimeoutSeconds, double sendTimeoutSeconds)
+    : _capacity(0),
+      _waitMode(waitMode),
+      _recvTimeoutSeconds(recvTimeoutSeconds),
+      _sendTimeoutSeconds(sendTimeoutSeconds),
+      _isParent(false),
+      _fd(childFd),
+      _region(nullptr),
+      _regionLen(0)
+    { }
+
+
+    LinuxSharedMemoryTransceiver::~LinuxSharedMemoryTransceiver()
+    {
+        deinit();
+    }
+
+
+    int LinuxSharedMemoryTransceiver::childFd() const
+    {
+        return _fd;
+    }
+
+
+    bool LinuxSharedMemoryTransceiver::init(void)
+    {
+        if(_region)
+        {
+            return true;
+        }
+
+        size_t ringLen = SpscByteRing::regionSize(_capacity);
+        if(_isParent)
+        {
+            //not close-on-exec, so that the fd can be handed to a child process
+            _fd = memfd_create("serial_library_shm", 0);
+            if(_fd < 0)
+            {
+                THROW_FATAL_SERIAL_LIB_EXCEPTION("memfd_create() failed: " + string(strerror(errno)));
+            }
+
+            _regionLen = 2 * ringLen;
+            if(ftruncate(_fd, _regionLen) < 0)
+            {
+                close(_fd);
+                _fd = -1;
+                THROW_FATAL_SERIAL_LIB_EXCEPTION("ftruncate() failed: " + string(strerror(errno)));
+            }
+        } else
+        {
+            struct stat st;
+            if(fstat(_fd, &st) < 0)
+            {
+                THROW_FATAL_SERIAL_LIB_EXCEPTION("fstat() failed on shared memory fd: " + string(strerror(errno)) + " ... has the fd been passed?");
+            }
+
+            _regionLen = st.st_size;
+            ringLen = _regionLen / 2;
+        }
+
+        _region = mmap(nullptr, _regionLen, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if(_region == MAP_FAILED)
+        {
+            _region = nullptr;
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("mmap() failed: " + string(strerror(errno)));
+        }
+
+        //the first ring carries parent to child, the second child to parent
+        char
+            *parentToChild = reinterpret_cast<char *>(_region),
+            *childToParent = parentToChild + ringLen;
+        
+        bool attached;
+        if(_isParent)
+        {
+            attached = _outbound.attach(parentToChild, ringLen, true, _capacity) && _inbound.attach(childToParent, ringLen, true, _capacity);
+        } else
+        {
+            attached = _inbound.attach(parentToChild, ringLen, false) && _outbound.attach(childToParent, ringLen, false);
+        }
+
+        if(!attached)
+        {
+            deinit();
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("Could not set up rings in shared memory");
+        }
+
+        return true;
+    }
+
+
+    void LinuxSharedMemoryTransceiver::send(const char *data, size_t numData)
+    {
+        SerialConstIoVec vec = { data, numData };
+        sendv(&vec, 1);
+    }
+
+
+    size_t LinuxSharedMemoryTransceiver::recv(char *data, size_t numData)
+    {
+        if(!_region)
+        {
+            return 0;
+        }
+
+        if(_inbound.readable() == 0 && !_inbound.waitReadable(_recvTimeoutSeconds, _waitMode == SHM_WAIT_SPIN))
+        {
+            return 0;
+        }
+
+        return _inbound.read(data, numData);
+    }
+
+
+    void LinuxSharedMemoryTransceiver::deinit(void)
+    {
+        if(_region)
+        {
+            munmap(_region, _regionLen);
+            _region = nullptr;
+        }
+
+        if(_fd >= 0)
+        {
+            close(_fd);
+            _fd = -1;
+        }
+
+        _inbound = SpscByteRing();
+        _outbound = SpscByteRing();
+    }
+
+
+    void LinuxSharedMemoryTransceiver::sendv(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        if(!_region)
+        {
+            return;
+        }
+
+        //frames are never split, so wait for the reader to make room for the whole thing
+        if(!_outbound.writev(vecs, numVecs))
+        {
+            size_t total = 0;
+            for(size_t i = 0; i < numVecs; i++)
+            {
+                total += vecs[i].numData;
+            }
+
+            if(!_outbound.waitWritable(total, _sendTimeoutSeconds, _waitMode == SHM_WAIT_SPIN) || !_outbound.writev(vecs, numVecs))
+            {
+                SERLIB_LOG_ERROR("Shared memory ring is full, dropping %d bytes", (int) total);
+            }
+        }
+    }
+
+
+    bool LinuxSharedMemoryTransceiver::waitForData(double timeoutSeconds)
+    {
+        return _inbound.waitReadable(timeoutSeconds, _waitMode == SHM_WAIT_SPIN);
+    }
+
+
+    unsigned int LinuxSharedMemoryTransceiver::capabilities(void) const
+    {
+        //readiness is signalled through a futex in the region, so there is no handle to poll
+        return TRANSCEIVER_CAP_NONE;
+    }
+}
+
+#endif
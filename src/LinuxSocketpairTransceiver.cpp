@@ -6,6 +6,19 @@
 
 namespace serial_library
 {
+    static int socketOption(int fd, int option, int defaultValue)
+    {
+        int value;
+        socklen_t valueLen = sizeof(value);
+        if(getsockopt(fd, SOL_SOCKET, option, &value, &valueLen) < 0)
+        {
+            return defaultValue;
+        }
+
+        return value;
+    }
+
+
     LinuxSocketpairTransceiver::LinuxSocketpairTransceiver(int domain, int type, int protocol, bool blocking)
     : _domain(domain),
       _type(type),
@@ -19,8 +32,8 @@ namespace serial_library
 
 
     LinuxSocketpairTransceiver::LinuxSocketpairTransceiver(int childFd)
-    : _domain(AF_UNIX),
-      _type(SOCK_STREAM),
+    : _domain(socketOption(childFd, SO_DOMAIN, AF_UNIX)),
+      _type(socketOption(childFd, SO_TYPE, SOCK_STREAM)),
       _protocol(0),
       _isParent(false),
       _blocking(false),
@@ -70,7 +83,7 @@ namespace serial_library
         if(_isParent)
         {
             int fds[2]; // 0 is parent fd, 1 is child fd
-            if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+            if(socketpair(_domain, _type, _protocol, fds) == -1)
             {
                 THROW_FATAL_SERIAL_LIB_EXCEPTION("Could not open socketpair: " + string(strerror(errno)));
                 _initialized = false;
@@ -161,7 +174,6 @@ namespace serial_library
 
     size_t LinuxSocketpairTransceiver::recv(char *data, size_t numData)
     {
-        memset(data, 0, numData);
         if(_initialized)
         {
             int fd = (_isParent ? _parentFd : _childFd);
@@ -195,6 +207,76 @@ namespace serial_library
 
         _initialized = false;
     }
+
+
+    void LinuxSocketpairTransceiver::sendv(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        iovec iovs[MAX_IO_VECS];
+        if(!toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            SerialTransceiver::sendv(vecs, numVecs);
+            return;
+        }
+
+        if(_initialized)
+        {
+            int fd = (_isParent ? _parentFd : _childFd);
+
+            if(writev(fd, iovs, numVecs) == -1)
+            {
+                SERLIB_LOG_ERROR("Failed to write: %s", strerror(errno));
+            }
+        }
+    }
+
+
+    size_t LinuxSocketpairTransceiver::recvv(const SerialIoVec *vecs, size_t numVecs)
+    {
+        iovec iovs[MAX_IO_VECS];
+        if(!toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            return SerialTransceiver::recvv(vecs, numVecs);
+        }
+
+        if(_initialized)
+        {
+            int fd = (_isParent ? _parentFd : _childFd);
+            ssize_t ret = readv(fd, iovs, numVecs);
+            if(ret < 0)
+            {
+                return 0;
+            }
+
+            return ret;
+        }
+
+        return 0;
+    }
+
+
+    unsigned int LinuxSocketpairTransceiver::capabilities(void) const
+    {
+        unsigned int caps = TRANSCEIVER_CAP_VECTORED_IO | TRANSCEIVER_CAP_NATIVE_HANDLE;
+
+        //seqpacket and datagram sockets hand each write to the other end as its own message
+        if((_type & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)) != SOCK_STREAM)
+        {
+            caps |= TRANSCEIVER_CAP_MESSAGE_BOUNDARIES;
+        }
+
+        return caps;
+    }
+
+
+    NativeHandle LinuxSocketpairTransceiver::nativeHandle(void) const
+    {
+        if(!_initialized)
+        {
+            return INVALID_NATIVE_HANDLE;
+        }
+
+        return (_isParent ? _parentFd : _childFd);
+    }
 }
 
 #endif
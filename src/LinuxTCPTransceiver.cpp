@@ -0,0 +1,610 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/ioctl.h>
+
+// tcp: https://man7.org/linux/man-pages/man7/tcp.7.html
+
+namespace serial_library
+{
+    static void setSocketTimeout(int sock, int option, double seconds)
+    {
+        timeval to;
+        to.tv_sec = (int) seconds;
+        to.tv_usec = (seconds - (double) to.tv_sec) * 1000000;
+        if(setsockopt(sock, SOL_SOCKET, option, &to, sizeof(to)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set socket timeout: %s", strerror(errno));
+        }
+    }
+
+
+    static bool pollSocket(int sock, short events, double timeoutSeconds)
+    {
+        pollfd pfd;
+        pfd.fd = sock;
+        pfd.events = events;
+        pfd.revents = 0;
+
+        timespec to;
+        to.tv_sec = (time_t) timeoutSeconds;
+        to.tv_nsec = (long) ((timeoutSeconds - (double) to.tv_sec) * 1000000000);
+        return ppoll(&pfd, 1, (timeoutSeconds < 0 ? nullptr : &to), nullptr) > 0;
+    }
+
+
+    LinuxTCPTransceiver::LinuxTCPTransceiver(
+        const std::string& address,
+        int port,
+        bool server,
+        double recvTimeoutSeconds,
+        bool allowAddrReuse,
+        const LinuxTCPTransceiverOptions& options)
+     : address(address),
+       port(port),
+       server(server),
+       allowAddrReuse(allowAddrReuse),
+       recvTimeoutSeconds(recvTimeoutSeconds),
+       options(options),
+       listenSock(-1),
+       sock(-1),
+       pollSet(-1),
+       reconnectTimer(-1),
+       connecting(false),
+       corked(false)
+    {
+        memset(&remote, 0, sizeof(remote));
+    }
+
+
+    bool LinuxTCPTransceiver::init(void)
+    {
+        //resolve address
+        addrinfo hints, *info;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if(getaddrinfo(address.c_str(), std::to_string(port).c_str(), &hints, &info) != 0 || !info)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("getaddrinfo() failed for address " + address);
+        }
+
+        memcpy(&remote, info->ai_addr, sizeof(remote));
+        freeaddrinfo(info);
+
+        //one handle for the life of the transceiver, whatever the sockets behind it do
+        pollSet = epoll_create1(EPOLL_CLOEXEC);
+        if(pollSet < 0)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("epoll_create1() failed: " + string(strerror(errno)));
+        }
+
+        if(!server)
+        {
+            reconnectTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if(reconnectTimer < 0)
+            {
+                THROW_FATAL_SERIAL_LIB_EXCEPTION("timerfd_create() failed: " + string(strerror(errno)));
+            }
+
+            watch(reconnectTimer, EPOLLIN);
+
+            //a device that is not up yet is not an error; the connection is retried from send() and recv()
+            if(!startConnect() || !finishConnect(options.connectTimeoutSeconds))
+            {
+                SERLIB_LOG_ERROR("Could not connect to %s:%d yet. Will keep trying", address.c_str(), port);
+            }
+
+            return true;
+        }
+
+        listenSock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if(listenSock < 0)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("socket() failed: " + string(strerror(errno)));
+        }
+
+        int option = 1;
+        if(allowAddrReuse && setsockopt(listenSock, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to allow addr reuse: %s. Continuing setup", strerror(errno));
+        }
+
+        //accepted sockets inherit the buffer sizes, which need to be set before the handshake
+        if(options.recvBufferSize > 0 && setsockopt(listenSock, SOL_SOCKET, SO_RCVBUF, &options.recvBufferSize, sizeof(options.recvBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set receive buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        if(options.sendBufferSize > 0 && setsockopt(listenSock, SOL_SOCKET, SO_SNDBUF, &options.sendBufferSize, sizeof(options.sendBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set send buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        if(bind(listenSock, (const sockaddr *) &remote, sizeof(remote)) < 0)
+        {
+            close(listenSock);
+            listenSock = -1;
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("bind() failed: " + string(strerror(errno)));
+        }
+
+        if(listen(listenSock, 1) < 0)
+        {
+            close(listenSock);
+            listenSock = -1;
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("listen() failed: " + string(strerror(errno)));
+        }
+
+        watch(listenSock, EPOLLIN);
+        SERLIB_LOG_DEBUG("TCP server listening on %s:%d", address.c_str(), port);
+        return true;
+    }
+
+
+    void LinuxTCPTransceiver::send(const char *data, size_t numData)
+    {
+        if(!ensureConnected(0))
+        {
+            SERLIB_LOG_DEBUG("Not connected to %s:%d, dropping %d bytes", address.c_str(), port, (int) numData);
+            return;
+        }
+
+        iovec iov;
+        iov.iov_base = (void *) data;
+        iov.iov_len = numData;
+        writeAll(&iov, 1, 0);
+    }
+
+
+    size_t LinuxTCPTransceiver::recv(char *data, size_t numData)
+    {
+        if(!ensureConnected(recvTimeoutSeconds))
+        {
+            return 0;
+        }
+
+        return handleRecv(::recv(sock, data, numData, 0));
+    }
+
+
+    void LinuxTCPTransceiver::deinit(void)
+    {
+        dropConnection();
+        if(listenSock >= 0)
+        {
+            close(listenSock);
+            listenSock = -1;
+        }
+
+        if(reconnectTimer >= 0)
+        {
+            close(reconnectTimer);
+            reconnectTimer = -1;
+        }
+
+        if(pollSet >= 0)
+        {
+            close(pollSet);
+            pollSet = -1;
+        }
+    }
+
+
+    void LinuxTCPTransceiver::sendv(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        iovec iovs[MAX_IO_VECS];
+        if(!toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            SerialTransceiver::sendv(vecs, numVecs);
+            return;
+        }
+
+        if(!ensureConnected(0))
+        {
+            SERLIB_LOG_DEBUG("Not connected to %s:%d, dropping data", address.c_str(), port);
+            return;
+        }
+
+        writeAll(iovs, numVecs, 0);
+    }
+
+
+    size_t LinuxTCPTransceiver::recvv(const SerialIoVec *vecs, size_t numVecs)
+    {
+        iovec iovs[MAX_IO_VECS];
+        if(!toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            return SerialTransceiver::recvv(vecs, numVecs);
+        }
+
+        if(!ensureConnected(recvTimeoutSeconds))
+        {
+            return 0;
+        }
+
+        return handleRecv(::readv(sock, iovs, numVecs));
+    }
+
+
+    void LinuxTCPTransceiver::sendPackets(const SerialConstIoVec *packets, size_t numPackets)
+    {
+        if(!ensureConnected(0))
+        {
+            SERLIB_LOG_DEBUG("Not connected to %s:%d, dropping %d packets", address.c_str(), port, (int) numPackets);
+            return;
+        }
+
+        //MSG_MORE holds everything but the last packet back, so the batch leaves in as few segments as possible
+        for(size_t i = 0; i < numPackets; i++)
+        {
+            iovec iov;
+            iov.iov_base = (void *) packets[i].data;
+            iov.iov_len = packets[i].numData;
+            if(!writeAll(&iov, 1, (i + 1 < numPackets ? MSG_MORE : 0)))
+            {
+                return;
+            }
+        }
+    }
+
+
+    bool LinuxTCPTransceiver::waitForData(double timeoutSeconds)
+    {
+        Time deadline = curtime() + std::chrono::microseconds((long) (timeoutSeconds * 1000000));
+        if(!ensureConnected(timeoutSeconds))
+        {
+            //between reconnect attempts that returns right away. wait out the rest of the timeout instead, or until
+            //the next attempt is due
+            if(timeoutSeconds != 0 && pollSet >= 0)
+            {
+                double remaining = (timeoutSeconds < 0 ? -1 : std::max(std::chrono::duration<double>(deadline - curtime()).count(), 0.0));
+                pollSocket(pollSet, POLLIN, remaining);
+            }
+
+            return false;
+        }
+
+        return SerialTransceiver::waitForData(timeoutSeconds);
+    }
+
+
+    unsigned int LinuxTCPTransceiver::capabilities(void) const
+    {
+        return TRANSCEIVER_CAP_VECTORED_IO | TRANSCEIVER_CAP_NATIVE_HANDLE;
+    }
+
+
+    NativeHandle LinuxTCPTransceiver::nativeHandle(void) const
+    {
+        return (pollSet >= 0 ? pollSet : INVALID_NATIVE_HANDLE);
+    }
+
+
+    size_t LinuxTCPTransceiver::outputBacklog(void) const
+    {
+        //the handle is the epoll set, which has no send queue
+        int queued = 0;
+        if(connected() && ioctl(sock, TIOCOUTQ, &queued) == 0 && queued > 0)
+        {
+            return queued;
+        }
+
+        return 0;
+    }
+
+
+    void LinuxTCPTransceiver::setCork(bool cork)
+    {
+        corked = cork;
+        int option = (cork ? 1 : 0);
+
+        //uncorking sends whatever was held back
+        if(connected() && setsockopt(sock, IPPROTO_TCP, TCP_CORK, &option, sizeof(option)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set TCP_CORK: %s", strerror(errno));
+        }
+    }
+
+
+    bool LinuxTCPTransceiver::connected(void) const
+    {
+        return sock >= 0 && !connecting;
+    }
+
+
+    bool LinuxTCPTransceiver::ensureConnected(double timeoutSeconds)
+    {
+        if(connected())
+        {
+            return true;
+        }
+
+        if(server)
+        {
+            return acceptClient(timeoutSeconds);
+        }
+
+        if(sock < 0)
+        {
+            //do not hammer a device that is down
+            if(curtime() - lastConnectAttempt < std::chrono::microseconds((long) (options.reconnectIntervalSeconds * 1000000)))
+            {
+                return false;
+            }
+
+            if(!startConnect())
+            {
+                return false;
+            }
+        }
+
+        return finishConnect(timeoutSeconds);
+    }
+
+
+    bool LinuxTCPTransceiver::startConnect(void)
+    {
+        //the attempt is happening now, so the timer has nothing left to signal
+        armReconnect(0);
+        lastConnectAttempt = curtime();
+        sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if(sock < 0)
+        {
+            SERLIB_LOG_ERROR("socket() failed: %s", strerror(errno));
+            return false;
+        }
+
+        //buffer sizes affect the window scale, which is negotiated during the handshake
+        if(options.recvBufferSize > 0 && setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &options.recvBufferSize, sizeof(options.recvBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set receive buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        if(options.sendBufferSize > 0 && setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &options.sendBufferSize, sizeof(options.sendBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set send buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        if(connect(sock, (const sockaddr *) &remote, sizeof(remote)) == 0)
+        {
+            configureConnection();
+            return true;
+        }
+
+        if(errno != EINPROGRESS)
+        {
+            SERLIB_LOG_DEBUG("connect() to %s:%d failed: %s", address.c_str(), port, strerror(errno));
+            dropConnection();
+            return false;
+        }
+
+        //writable once the handshake is done, either way
+        connecting = true;
+        watch(sock, EPOLLOUT);
+        return true;
+    }
+
+
+    bool LinuxTCPTransceiver::finishConnect(double timeoutSeconds)
+    {
+        if(!connecting)
+        {
+            return connected();
+        }
+
+        if(!pollSocket(sock, POLLOUT, timeoutSeconds))
+        {
+            return false;
+        }
+
+        int error = 0;
+        socklen_t errorLen = sizeof(error);
+        if(getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &errorLen) < 0 || error != 0)
+        {
+            SERLIB_LOG_DEBUG("connect() to %s:%d failed: %s", address.c_str(), port, strerror(error));
+            dropConnection();
+            return false;
+        }
+
+        connecting = false;
+        configureConnection();
+        return true;
+    }
+
+
+    bool LinuxTCPTransceiver::acceptClient(double timeoutSeconds)
+    {
+        if(listenSock < 0 || !pollSocket(listenSock, POLLIN, timeoutSeconds))
+        {
+            return false;
+        }
+
+        sock = accept(listenSock, nullptr, nullptr);
+        if(sock < 0)
+        {
+            if(errno != EAGAIN)
+            {
+                SERLIB_LOG_DEBUG("accept() failed: %s", strerror(errno));
+            }
+
+            return false;
+        }
+
+        configureConnection();
+        return true;
+    }
+
+
+    void LinuxTCPTransceiver::configureConnection(void)
+    {
+        //the stream is blocking from here on, bounded by the socket timeouts
+        int flags = fcntl(sock, F_GETFL);
+        if(flags == -1 || fcntl(sock, F_SETFL, flags & ~O_NONBLOCK) == -1)
+        {
+            SERLIB_LOG_ERROR("Could not clear O_NONBLOCK on TCP socket: %s", strerror(errno));
+        }
+
+        setSocketTimeout(sock, SO_RCVTIMEO, recvTimeoutSeconds);
+        setSocketTimeout(sock, SO_SNDTIMEO, options.sendTimeoutSeconds);
+
+        int option = (options.noDelay ? 1 : 0);
+        if(setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set TCP_NODELAY: %s", strerror(errno));
+        }
+
+        if(corked)
+        {
+            setCork(true);
+        }
+
+        //one client at a time, so the next one waits in the backlog until this one goes away
+        if(listenSock >= 0)
+        {
+            unwatch(listenSock);
+        }
+
+        watch(sock, EPOLLIN);
+        SERLIB_LOG_DEBUG("TCP connection to %s:%d established", address.c_str(), port);
+    }
+
+
+    void LinuxTCPTransceiver::dropConnection(void)
+    {
+        if(sock >= 0)
+        {
+            unwatch(sock);
+            close(sock);
+        }
+
+        sock = -1;
+        connecting = false;
+
+        //the handle shows the next client, or when to try again
+        if(listenSock >= 0)
+        {
+            watch(listenSock, EPOLLIN);
+        } else if(reconnectTimer >= 0)
+        {
+            armReconnect(std::max(options.reconnectIntervalSeconds, 0.001));
+        }
+    }
+
+
+    void LinuxTCPTransceiver::watch(int fd, uint32_t events)
+    {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        if(pollSet >= 0 && epoll_ctl(pollSet, EPOLL_CTL_MOD, fd, &event) < 0
+            && (errno != ENOENT || epoll_ctl(pollSet, EPOLL_CTL_ADD, fd, &event) < 0))
+        {
+            SERLIB_LOG_ERROR("epoll_ctl() failed for TCP transceiver: %s", strerror(errno));
+        }
+    }
+
+
+    void LinuxTCPTransceiver::unwatch(int fd)
+    {
+        if(pollSet >= 0)
+        {
+            epoll_ctl(pollSet, EPOLL_CTL_DEL, fd, nullptr);
+        }
+    }
+
+
+    void LinuxTCPTransceiver::armReconnect(double seconds)
+    {
+        if(reconnectTimer < 0)
+        {
+            return;
+        }
+
+        //0 disarms it. an expiry that was not read yet is cleared too
+        uint64_t expirations;
+        if(read(reconnectTimer, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        {
+            SERLIB_LOG_DEBUG("read() on reconnect timer failed: %s", strerror(errno));
+        }
+
+        itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        spec.it_value.tv_sec = (time_t) seconds;
+        spec.it_value.tv_nsec = (long) ((seconds - (double) spec.it_value.tv_sec) * 1000000000);
+        timerfd_settime(reconnectTimer, 0, &spec, nullptr);
+    }
+
+
+    size_t LinuxTCPTransceiver::handleRecv(ssize_t ret)
+    {
+        if(ret > 0)
+        {
+            return ret;
+        }
+
+        //zero bytes means the other side closed the connection
+        if(ret == 0 || (errno != EAGAIN && errno != EINTR))
+        {
+            SERLIB_LOG_DEBUG("TCP connection to %s:%d closed: %s", address.c_str(), port, (ret == 0 ? "end of stream" : strerror(errno)));
+            dropConnection();
+        }
+
+        return 0;
+    }
+
+
+    bool LinuxTCPTransceiver::writeAll(iovec *iovs, size_t numIovs, int flags)
+    {
+        //the stream may take only part of the data, so keep going from where it stopped
+        while(numIovs > 0)
+        {
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iovs;
+            msg.msg_iovlen = numIovs;
+            ssize_t ret = ::sendmsg(sock, &msg, flags | MSG_NOSIGNAL);
+            if(ret < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+
+                if(errno == EAGAIN)
+                {
+                    SERLIB_LOG_ERROR("Send to %s:%d timed out with data left to send", address.c_str(), port);
+                } else
+                {
+                    SERLIB_LOG_DEBUG("sendmsg() to %s:%d failed: %s", address.c_str(), port, strerror(errno));
+                    dropConnection();
+                }
+
+                return false;
+            }
+
+            size_t sent = ret;
+            while(numIovs > 0 && sent >= iovs->iov_len)
+            {
+                sent -= iovs->iov_len;
+                iovs++;
+                numIovs--;
+            }
+
+            if(numIovs > 0)
+            {
+                iovs->iov_base = (char *) iovs->iov_base + sent;
+                iovs->iov_len -= sent;
+            }
+        }
+
+        return true;
+    }
+}
+
+#endif
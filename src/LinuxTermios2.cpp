@@ -0,0 +1,44 @@
+//
+// termios2 needs the kernel's struct termios from <asm/termbits.h>, which clashes with the one in <termios.h>.
+// serial_library.hpp includes <termios.h>, so this file only includes the base header.
+//
+
+#include "serial_library/serial_library_base.hpp"
+
+#if defined(USE_LINUX)
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+namespace serial_library
+{
+    bool setCustomBaud(int fd, int baud)
+    {
+        struct termios2 config;
+        if(ioctl(fd, TCGETS2, &config) < 0)
+        {
+            return false;
+        }
+
+        //BOTHER takes the rate from c_ispeed and c_ospeed instead of a B* constant
+        config.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+        config.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+        config.c_ispeed = baud;
+        config.c_ospeed = baud;
+        return ioctl(fd, TCSETS2, &config) == 0;
+    }
+
+
+    int getBaud(int fd)
+    {
+        struct termios2 config;
+        if(ioctl(fd, TCGETS2, &config) < 0)
+        {
+            return -1;
+        }
+
+        return config.c_ospeed;
+    }
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+#include <arpa/inet.h>
+
+// ip multicast: https://man7.org/linux/man-pages/man7/ip.7.html
+
+namespace serial_library
+{
+    LinuxUDPMulticastTransceiver::LinuxUDPMulticastTransceiver(
+        const std::string& groupAddress,
+        int port,
+        const std::string& interfaceAddress,
+        int ttl,
+        bool loopback,
+        double recvTimeoutSeconds)
+     : groupAddress(groupAddress),
+       interfaceAddress(interfaceAddress),
+       port(port),
+       ttl(ttl),
+       loopback(loopback),
+       recvTimeoutSeconds(recvTimeoutSeconds),
+       sock(-1)
+    {
+        memset(&group, 0, sizeof(group));
+    }
+
+
+    bool LinuxUDPMulticastTransceiver::init(void)
+    {
+        group.sin_family = AF_INET;
+        group.sin_port = htons(port);
+        if(inet_pton(AF_INET, groupAddress.c_str(), &group.sin_addr) != 1 || !IN_MULTICAST(ntohl(group.sin_addr.s_addr)))
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("Invalid multicast group address: " + groupAddress);
+        }
+
+        in_addr iface;
+        if(inet_pton(AF_INET, interfaceAddress.c_str(), &iface) != 1)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("Invalid interface address: " + interfaceAddress);
+        }
+
+        sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if(sock < 0)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("socket() failed: " + string(strerror(errno)));
+        }
+
+        //set socket timeout
+        timeval to;
+        to.tv_sec = (int) recvTimeoutSeconds;
+        to.tv_usec = (recvTimeoutSeconds - (double) to.tv_sec) * 1000000;
+        if(setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &to, sizeof(to)) < 0)
+        {
+            close(sock);
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("setsockopt() failed while trying to set socket recv timeout: " + string(strerror(errno)));
+        }
+
+        //every subscriber on this host binds the same port
+        int option = 1;
+        if(setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to allow addr reuse: %s. Continuing setup", strerror(errno));
+        }
+
+        sockaddr_in bindaddr;
+        memset(&bindaddr, 0, sizeof(bindaddr));
+        bindaddr.sin_family = AF_INET;
+        bindaddr.sin_addr.s_addr = INADDR_ANY;
+        bindaddr.sin_port = htons(port);
+        if(bind(sock, (const sockaddr *) &bindaddr, sizeof(bindaddr)) < 0)
+        {
+            close(sock);
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("bind() failed: " + string(strerror(errno)));
+        }
+
+        //only deliver groups this socket joined, not every group joined on the host
+        option = 0;
+        if(setsockopt(sock, IPPROTO_IP, IP_MULTICAST_ALL, &option, sizeof(option)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to disable IP_MULTICAST_ALL: %s. Continuing setup", strerror(errno));
+        }
+
+        if(setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set multicast interface: %s. Continuing setup", strerror(errno));
+        }
+
+        if(!setTtl(ttl) || !setLoopback(loopback) || !joinGroup(groupAddress))
+        {
+            close(sock);
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("Failed to set up multicast group " + groupAddress);
+        }
+
+        SERLIB_LOG_DEBUG("Joined multicast group %s on port %d", groupAddress.c_str(), port);
+        return true;
+    }
+
+
+    void LinuxUDPMulticastTransceiver::send(const char *data, size_t numData)
+    {
+        if(::sendto(sock, data, numData, 0, (const sockaddr *) &group, sizeof(group)) == -1)
+        {
+            SERLIB_LOG_DEBUG("sendto() to group %s failed: %s", groupAddress.c_str(), strerror(errno));
+        }
+    }
+
+
+    size_t LinuxUDPMulticastTransceiver::recv(char *data, size_t numData)
+    {
+        ssize_t ret = ::recv(sock, data, numData, 0);
+        if(ret == -1)
+        {
+            if(errno != EAGAIN)
+            {
+                SERLIB_LOG_DEBUG("recv() from group %s failed (%d) : %s", groupAddress.c_str(), errno, strerror(errno));
+            }
+
+            return 0;
+        }
+
+        return ret;
+    }
+
+
+    void LinuxUDPMulticastTransceiver::deinit(void)
+    {
+        //closing the socket leaves every group it joined
+        close(sock);
+        sock = -1;
+    }
+
+
+    unsigned int LinuxUDPMulticastTransceiver::capabilities(void) const
+    {
+        return TRANSCEIVER_CAP_NATIVE_HANDLE | TRANSCEIVER_CAP_MESSAGE_BOUNDARIES;
+    }
+
+
+    NativeHandle LinuxUDPMulticastTransceiver::nativeHandle(void) const
+    {
+        return sock;
+    }
+
+
+    bool LinuxUDPMulticastTransceiver::joinGroup(const std::string& groupAddress)
+    {
+        return changeMembership(groupAddress, IP_ADD_MEMBERSHIP);
+    }
+
+
+    bool LinuxUDPMulticastTransceiver::leaveGroup(const std::string& groupAddress)
+    {
+        return changeMembership(groupAddress, IP_DROP_MEMBERSHIP);
+    }
+
+
+    bool LinuxUDPMulticastTransceiver::setTtl(int ttl)
+    {
+        this->ttl = ttl;
+        if(sock >= 0 && setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set multicast TTL: %s", strerror(errno));
+            return false;
+        }
+
+        return true;
+    }
+
+
+    bool LinuxUDPMulticastTransceiver::setLoopback(bool loopback)
+    {
+        this->loopback = loopback;
+        unsigned char enable = (loopback ? 1 : 0);
+        if(sock >= 0 && setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &enable, sizeof(enable)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set multicast loopback: %s", strerror(errno));
+            return false;
+        }
+
+        return true;
+    }
+
+
+    bool LinuxUDPMulticastTransceiver::changeMembership(const std::string& groupAddress, int option)
+    {
+        ip_mreq request;
+        if(inet_pton(AF_INET, groupAddress.c_str(), &request.imr_multiaddr) != 1 
+            || inet_pton(AF_INET, interfaceAddress.c_str(), &request.imr_interface) != 1)
+        {
+            SERLIB_LOG_ERROR("Invalid multicast group address %s", groupAddress.c_str());
+            return false;
+        }
+
+        if(setsockopt(sock, IPPROTO_IP, option, &request, sizeof(request)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to %s group %s: %s", (option == IP_ADD_MEMBERSHIP ? "join" : "leave"), groupAddress.c_str(), strerror(errno));
+            return false;
+        }
+
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+namespace serial_library
+{
+    LinuxUDPPeerTransceiver::LinuxUDPPeerTransceiver(const LinuxUDPServerTransceiver::SharedPtr& server, const sockaddr_in& address)
+     : server(server),
+       address(address),
+       key(LinuxUDPServerTransceiver::peerKey(address)) { }
+
+
+    bool LinuxUDPPeerTransceiver::init(void)
+    {
+        server->attachPeer(key, address);
+        return server->nativeHandle() >= 0;
+    }
+
+
+    void LinuxUDPPeerTransceiver::send(const char *data, size_t numData)
+    {
+        server->queueSend(key, data, numData);
+    }
+
+
+    size_t LinuxUDPPeerTransceiver::recv(char *data, size_t numData)
+    {
+        return server->takeReceived(key, data, numData);
+    }
+
+
+    void LinuxUDPPeerTransceiver::deinit(void)
+    {
+        server->detachPeer(key);
+    }
+
+
+    bool LinuxUDPPeerTransceiver::waitForData(double timeoutSeconds)
+    {
+        if(!server->hasReceived(key))
+        {
+            server->receive(timeoutSeconds);
+        }
+
+        return server->hasReceived(key);
+    }
+
+
+    unsigned int LinuxUDPPeerTransceiver::capabilities(void) const
+    {
+        return TRANSCEIVER_CAP_MESSAGE_BOUNDARIES;
+    }
+}
+
+#endif
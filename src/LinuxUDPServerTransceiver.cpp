@@ -0,0 +1,371 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+#include <arpa/inet.h>
+#include <netdb.h>
+
+// datagrams kept for a peer that is not reading, and replies kept while the socket cannot take them. the oldest go first
+#define MAX_PEER_RECEIVED_DATAGRAMS 1024
+#define MAX_OUTBOUND_DATAGRAMS 1024
+
+namespace serial_library
+{
+    LinuxUDPServerTransceiver::LinuxUDPServerTransceiver(int port, bool allowAddrReuse, const LinuxUDPTransceiverOptions& options)
+     : port(port),
+       allowAddrReuse(allowAddrReuse),
+       options(options),
+       sock(-1) { }
+
+
+    LinuxUDPServerTransceiver::~LinuxUDPServerTransceiver()
+    {
+        deinit();
+    }
+
+
+    bool LinuxUDPServerTransceiver::init(void)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        if(sock >= 0)
+        {
+            return true;
+        }
+
+        sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if(sock < 0)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("socket() failed: " + string(strerror(errno)));
+        }
+
+        int option = 1;
+        if(allowAddrReuse && setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to allow addr reuse: %s. Continuing setup", strerror(errno));
+        }
+
+        if(options.recvBufferSize > 0 && setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &options.recvBufferSize, sizeof(options.recvBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set receive buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        if(options.sendBufferSize > 0 && setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &options.sendBufferSize, sizeof(options.sendBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set send buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        sockaddr_in bindaddr;
+        memset(&bindaddr, 0, sizeof(bindaddr));
+        bindaddr.sin_family = AF_INET;
+        bindaddr.sin_addr.s_addr = INADDR_ANY;
+        bindaddr.sin_port = htons(port);
+        if(bind(sock, (const sockaddr *) &bindaddr, sizeof(bindaddr)) < 0)
+        {
+            close(sock);
+            sock = -1;
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("bind() failed: " + string(strerror(errno)));
+        }
+
+        //slots for recvmmsg(). a server always batches, so a batch size of 1 means the largest batch
+        size_t batchSize = (options.batchSize > 1 ? options.batchSize : MAX_PACKET_BATCH);
+        slots.resize(batchSize * options.maxDatagramSize);
+        slotHeaders.resize(batchSize);
+        slotIovs.resize(batchSize);
+        slotAddresses.resize(batchSize);
+        for(size_t i = 0; i < batchSize; i++)
+        {
+            slotIovs[i].iov_base = &slots[i * options.maxDatagramSize];
+            slotIovs[i].iov_len = options.maxDatagramSize;
+            memset(&slotHeaders[i], 0, sizeof(slotHeaders[i]));
+            slotHeaders[i].msg_hdr.msg_iov = &slotIovs[i];
+            slotHeaders[i].msg_hdr.msg_iovlen = 1;
+            slotHeaders[i].msg_hdr.msg_name = &slotAddresses[i];
+        }
+
+        SERLIB_LOG_DEBUG("UDP server bound to port %d", port);
+        return true;
+    }
+
+
+    void LinuxUDPServerTransceiver::deinit(void)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        if(sock >= 0)
+        {
+            flushLocked();
+            close(sock);
+            sock = -1;
+        }
+
+        outbound.clear();
+    }
+
+
+    SerialTransceiver::UniquePtr LinuxUDPServerTransceiver::peer(const std::string& address, int port)
+    {
+        sockaddr_in resolved;
+        if(!resolve(address, port, resolved))
+        {
+            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION("Could not resolve peer address " + address);
+        }
+
+        attachPeer(peerKey(resolved), resolved);
+        return std::make_unique<LinuxUDPPeerTransceiver>(shared_from_this(), resolved);
+    }
+
+
+    void LinuxUDPServerTransceiver::setNewPeerCallback(const NewPeerCallback& callback)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        newPeerCallback = callback;
+    }
+
+
+    size_t LinuxUDPServerTransceiver::receive(double timeoutSeconds)
+    {
+        if(sock < 0)
+        {
+            return 0;
+        }
+
+        //wait outside of the lock so that peers can keep sending
+        if(timeoutSeconds != 0)
+        {
+            pollfd pfd;
+            pfd.fd = sock;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+
+            timespec to;
+            to.tv_sec = (time_t) timeoutSeconds;
+            to.tv_nsec = (long) ((timeoutSeconds - (double) to.tv_sec) * 1000000000);
+            if(ppoll(&pfd, 1, (timeoutSeconds < 0 ? nullptr : &to), nullptr) <= 0)
+            {
+                return 0;
+            }
+        }
+
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        size_t total = 0;
+        int ret;
+        do
+        {
+            for(size_t i = 0; i < slotHeaders.size(); i++)
+            {
+                slotHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            }
+
+            ret = ::recvmmsg(sock, slotHeaders.data(), slotHeaders.size(), MSG_DONTWAIT, nullptr);
+            if(ret < 0)
+            {
+                if(errno != EAGAIN)
+                {
+                    SERLIB_LOG_DEBUG("recvmmsg() on UDP server failed (%d) : %s", errno, strerror(errno));
+                }
+
+                break;
+            }
+
+            for(int i = 0; i < ret; i++)
+            {
+                const sockaddr_in& from = slotAddresses[i];
+                uint64_t key = peerKey(from);
+                auto it = peers.find(key);
+                if(it == peers.end() && newPeerCallback)
+                {
+                    //give the user a chance to create a peer for this address
+                    char addressString[INET_ADDRSTRLEN];
+                    inet_ntop(AF_INET, &from.sin_addr, addressString, sizeof(addressString));
+                    newPeerCallback(std::string(addressString), ntohs(from.sin_port));
+                    it = peers.find(key);
+                }
+
+                if(it == peers.end() || !it->second.attached)
+                {
+                    SERLIB_LOG_DEBUG("Dropping datagram from unknown peer");
+                    continue;
+                }
+
+                if(slotHeaders[i].msg_hdr.msg_flags & MSG_TRUNC)
+                {
+                    SERLIB_LOG_ERROR("Dropping datagram larger than %zu bytes", options.maxDatagramSize);
+                    continue;
+                }
+
+                std::deque<vector<char>>& received = it->second.received;
+                if(received.size() >= MAX_PEER_RECEIVED_DATAGRAMS)
+                {
+                    SERLIB_LOG_DEBUG("Peer is not reading, dropping its oldest datagram");
+                    received.pop_front();
+                }
+
+                const char *slot = &slots[i * options.maxDatagramSize];
+                received.emplace_back(slot, slot + slotHeaders[i].msg_len);
+            }
+
+            total += ret;
+        } while(ret == (int) slotHeaders.size());
+
+        return total;
+    }
+
+
+    size_t LinuxUDPServerTransceiver::flush(void)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        return flushLocked();
+    }
+
+
+    NativeHandle LinuxUDPServerTransceiver::nativeHandle(void) const
+    {
+        return sock;
+    }
+
+
+    size_t LinuxUDPServerTransceiver::numPeers(void)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        return peers.size();
+    }
+
+
+    uint64_t LinuxUDPServerTransceiver::peerKey(const sockaddr_in& address)
+    {
+        return ((uint64_t) ntohl(address.sin_addr.s_addr) << 16) | ntohs(address.sin_port);
+    }
+
+
+    bool LinuxUDPServerTransceiver::resolve(const std::string& address, int port, sockaddr_in& resolved)
+    {
+        addrinfo hints, *info;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        if(getaddrinfo(address.c_str(), std::to_string(port).c_str(), &hints, &info) != 0 || !info)
+        {
+            SERLIB_LOG_ERROR("getaddrinfo() failed for peer address %s", address.c_str());
+            return false;
+        }
+
+        memcpy(&resolved, info->ai_addr, sizeof(resolved));
+        freeaddrinfo(info);
+        return true;
+    }
+
+
+    void LinuxUDPServerTransceiver::attachPeer(uint64_t key, const sockaddr_in& address)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        Peer& peer = peers[key];
+        peer.address = address;
+        peer.attached = true;
+    }
+
+
+    void LinuxUDPServerTransceiver::detachPeer(uint64_t key)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        peers.erase(key);
+    }
+
+
+    void LinuxUDPServerTransceiver::queueSend(uint64_t key, const char *data, size_t numData)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        auto it = peers.find(key);
+        if(it == peers.end())
+        {
+            return;
+        }
+
+        if(outbound.size() >= MAX_OUTBOUND_DATAGRAMS)
+        {
+            SERLIB_LOG_DEBUG("UDP server send queue is full, dropping the oldest reply");
+            outbound.erase(outbound.begin());
+        }
+
+        outbound.emplace_back();
+        outbound.back().to = it->second.address;
+        outbound.back().data.assign(data, data + numData);
+        if(outbound.size() >= MAX_PACKET_BATCH)
+        {
+            flushLocked();
+        }
+    }
+
+
+    size_t LinuxUDPServerTransceiver::takeReceived(uint64_t key, char *data, size_t numData)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        auto it = peers.find(key);
+        if(it == peers.end() || it->second.received.empty())
+        {
+            return 0;
+        }
+
+        //one datagram per call, truncated like recv() would
+        const vector<char>& datagram = it->second.received.front();
+        size_t len = std::min(numData, datagram.size());
+        memcpy(data, datagram.data(), len);
+        it->second.received.pop_front();
+        return len;
+    }
+
+
+    bool LinuxUDPServerTransceiver::hasReceived(uint64_t key)
+    {
+        std::lock_guard<std::recursive_mutex> guard(lock);
+        auto it = peers.find(key);
+        return it != peers.end() && !it->second.received.empty();
+    }
+
+
+    size_t LinuxUDPServerTransceiver::flushLocked(void)
+    {
+        mmsghdr headers[MAX_PACKET_BATCH];
+        iovec iovs[MAX_PACKET_BATCH];
+        size_t
+            sent = 0,
+            done = 0;
+
+        while(sock >= 0 && done < outbound.size())
+        {
+            size_t numBatch = std::min(outbound.size() - done, (size_t) MAX_PACKET_BATCH);
+            for(size_t i = 0; i < numBatch; i++)
+            {
+                OutboundDatagram& datagram = outbound[done + i];
+                iovs[i].iov_base = datagram.data.data();
+                iovs[i].iov_len = datagram.data.size();
+                memset(&headers[i], 0, sizeof(headers[i]));
+                headers[i].msg_hdr.msg_name = &datagram.to;
+                headers[i].msg_hdr.msg_namelen = sizeof(datagram.to);
+                headers[i].msg_hdr.msg_iov = &iovs[i];
+                headers[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int ret = ::sendmmsg(sock, headers, numBatch, 0);
+            if(ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR))
+            {
+                //the socket is full. the rest goes out on the next flush
+                break;
+            }
+
+            if(ret <= 0)
+            {
+                //only the first datagram failed, and it would fail again
+                SERLIB_LOG_DEBUG("sendmmsg() from UDP server failed, dropping a reply: %s", strerror(errno));
+                done++;
+                continue;
+            }
+
+            sent += ret;
+            done += ret;
+        }
+
+        outbound.erase(outbound.begin(), outbound.begin() + done);
+        return sent;
+    }
+}
+
+#endif
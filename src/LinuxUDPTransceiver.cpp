@@ -5,18 +5,58 @@
 #include <netinet/in.h>
 #include <netinet/udp.h>
 #include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+
+#define UDP_MAX_PAYLOAD 65507
+#define UDP_MAX_GSO_SEGMENTS 64
+#define UDP_SLOT_CONTROL_SIZE (CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(timespec)))
 
 namespace serial_library
 {
+    // how many datagrams from the start of packets go down as one segmented send. 1 if the first cannot be merged
+    static size_t gsoRunLength(const SerialConstIoVec *packets, size_t numPackets)
+    {
+        size_t 
+            numRun = 1,
+            runBytes = packets[0].numData;
+        
+        while(numRun < numPackets 
+            && numRun < UDP_MAX_GSO_SEGMENTS
+            && packets[numRun].numData == packets[0].numData
+            && runBytes + packets[numRun].numData <= UDP_MAX_PAYLOAD)
+        {
+            runBytes += packets[numRun].numData;
+            numRun++;
+        }
+
+        return numRun;
+    }
+
 
-    LinuxUDPTransceiver::LinuxUDPTransceiver(const std::string& address, int port, double recvTimeoutSeconds, bool skipBind, bool skipConnect, bool allowAddrReuse)
+    LinuxUDPTransceiver::LinuxUDPTransceiver(
+        const std::string& address,
+        int port,
+        double recvTimeoutSeconds,
+        bool skipBind,
+        bool skipConnect,
+        bool allowAddrReuse,
+        const LinuxUDPTransceiverOptions& options)
      : address(address),
        port(port),
        recvTimeoutSeconds(recvTimeoutSeconds),
        allowAddrReuse(allowAddrReuse),
        skipBind(skipBind),
        skipConnect(skipConnect),
-       sock(-1) { }
+       options(options),
+       sock(-1),
+       slotSize(0),
+       nextPending(0),
+       gsoEnabled(options.useGso),
+       dropped(0),
+       pollSet(-1),
+       pendingEvent(-1) { }
 
 
     bool LinuxUDPTransceiver::init(void)
@@ -39,6 +79,84 @@ namespace serial_library
             THROW_FATAL_SERIAL_LIB_EXCEPTION("setsockopt() failed while trying to set socket recv timeout: " + string(strerror(errno)));
         }
 
+        //size kernel buffers so that bursts are not dropped between updates
+        if(options.recvBufferSize > 0 && setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &options.recvBufferSize, sizeof(options.recvBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set receive buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        if(options.sendBufferSize > 0 && setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &options.sendBufferSize, sizeof(options.sendBufferSize)) < 0)
+        {
+            SERLIB_LOG_ERROR("setsockopt() failed while trying to set send buffer size: %s. Continuing setup", strerror(errno));
+        }
+
+        //ask the stack to merge consecutive datagrams from the same flow. they are split up again in fillSlots()
+        bool groEnabled = false;
+        if(options.useGro)
+        {
+            int enable = 1;
+            groEnabled = setsockopt(sock, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+            if(!groEnabled)
+            {
+                SERLIB_LOG_ERROR("setsockopt() failed while trying to enable UDP_GRO: %s. Continuing setup", strerror(errno));
+            }
+        }
+
+        if(options.receiveTimestamps)
+        {
+            int enable = 1;
+            if(setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0)
+            {
+                SERLIB_LOG_ERROR("setsockopt() failed while trying to enable SO_TIMESTAMPNS: %s. Continuing setup", strerror(errno));
+            }
+        }
+
+        //slots for recvmmsg(). merged datagrams can be up to the maximum udp payload
+        if(usingSlots())
+        {
+            size_t batchSize = std::max(options.batchSize, (size_t) 1);
+            slotSize = (groEnabled ? std::max(options.maxDatagramSize, (size_t) UDP_MAX_PAYLOAD) : options.maxDatagramSize);
+            slots.resize(batchSize * slotSize);
+            slotControl.resize(batchSize * UDP_SLOT_CONTROL_SIZE);
+            slotHeaders.resize(batchSize);
+            slotIovs.resize(batchSize);
+            for(size_t i = 0; i < batchSize; i++)
+            {
+                slotIovs[i].iov_base = &slots[i * slotSize];
+                slotIovs[i].iov_len = slotSize;
+                memset(&slotHeaders[i], 0, sizeof(slotHeaders[i]));
+                slotHeaders[i].msg_hdr.msg_iov = &slotIovs[i];
+                slotHeaders[i].msg_hdr.msg_iovlen = 1;
+            }
+        }
+
+        pending.clear();
+        nextPending = 0;
+        gsoEnabled = options.useGso;
+
+        //datagrams taken by recvmmsg() wait in the slots, where the socket cannot show them. the handle is an epoll set
+        //of the socket and an eventfd that stays readable while any of them are left, so it is readable whenever
+        //recv() has something to return
+        if(usingSlots())
+        {
+            pollSet = epoll_create1(EPOLL_CLOEXEC);
+            pendingEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            epoll_event socketEvent, pendingEventEvent;
+            memset(&socketEvent, 0, sizeof(socketEvent));
+            memset(&pendingEventEvent, 0, sizeof(pendingEventEvent));
+            socketEvent.events = EPOLLIN;
+            socketEvent.data.fd = sock;
+            pendingEventEvent.events = EPOLLIN;
+            pendingEventEvent.data.fd = pendingEvent;
+            if(pollSet < 0 || pendingEvent < 0
+                || epoll_ctl(pollSet, EPOLL_CTL_ADD, sock, &socketEvent) < 0
+                || epoll_ctl(pollSet, EPOLL_CTL_ADD, pendingEvent, &pendingEventEvent) < 0)
+            {
+                SERLIB_LOG_ERROR("Could not set up readiness handle: %s. Datagrams left from a batch will not show on it", strerror(errno));
+                closeReadiness();
+            }
+        }
+
         //allow the address to be used if the user wants. needed for testing on local machine
         int option = 1;
         if(allowAddrReuse)
@@ -132,6 +250,21 @@ namespace serial_library
 
     size_t LinuxUDPTransceiver::recv(char *data, size_t numData)
     {
+        if(usingSlots())
+        {
+            if(nextPending >= pending.size() && !fillSlots())
+            {
+                return 0;
+            }
+
+            //one datagram per call, truncated like recv() would
+            const SerialPacketInfo& datagram = pending[nextPending++];
+            size_t len = std::min(numData, datagram.length);
+            memcpy(data, &slots[datagram.offset], len);
+            updateReadiness();
+            return len;
+        }
+
         size_t ret = ::recv(sock, data, numData, 0);
         if((ssize_t) ret == -1)
         {
@@ -149,7 +282,360 @@ namespace serial_library
 
     void LinuxUDPTransceiver::deinit(void)
     {
+        closeReadiness();
         close(sock);
+        sock = -1;
+    }
+
+
+    void LinuxUDPTransceiver::sendv(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        msghdr msg;
+        iovec iovs[MAX_IO_VECS];
+        if(!toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            SerialTransceiver::sendv(vecs, numVecs);
+            return;
+        }
+
+        //all pieces go out in one datagram
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iovs;
+        msg.msg_iovlen = numVecs;
+        if(::sendmsg(sock, &msg, 0) == -1)
+        {
+            SERLIB_LOG_DEBUG("sendmsg() to %s failed: %s", address.c_str(), strerror(errno));
+        }
+    }
+
+
+    size_t LinuxUDPTransceiver::recvv(const SerialIoVec *vecs, size_t numVecs)
+    {
+        msghdr msg;
+        iovec iovs[MAX_IO_VECS];
+        if(usingSlots() || !toIovecs(vecs, numVecs, iovs, MAX_IO_VECS))
+        {
+            return SerialTransceiver::recvv(vecs, numVecs);
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iovs;
+        msg.msg_iovlen = numVecs;
+        ssize_t ret = ::recvmsg(sock, &msg, 0);
+        if(ret == -1)
+        {
+            if(errno != EAGAIN)
+            {
+                SERLIB_LOG_DEBUG("recvmsg() from %s failed (%d) : %s", address.c_str(), errno, strerror(errno));
+            }
+
+            return 0;
+        }
+
+        return ret;
+    }
+
+
+    size_t LinuxUDPTransceiver::recvPackets(char *data, size_t numData, SerialPacketInfo *packets, size_t maxPackets)
+    {
+        if(!usingSlots())
+        {
+            return SerialTransceiver::recvPackets(data, numData, packets, maxPackets);
+        }
+
+        if(nextPending >= pending.size())
+        {
+            fillSlots();
+        }
+
+        //copy out as many whole datagrams as fit. the rest wait for the next call
+        size_t 
+            numPackets = 0,
+            cursor = 0;
+        
+        while(numPackets < maxPackets && nextPending < pending.size())
+        {
+            const SerialPacketInfo& datagram = pending[nextPending];
+            size_t len = datagram.length;
+            if(cursor + len > numData)
+            {
+                if(numPackets > 0)
+                {
+                    break;
+                }
+
+                len = numData;
+            }
+
+            memcpy(data + cursor, &slots[datagram.offset], len);
+            packets[numPackets].offset = cursor;
+            packets[numPackets].length = len;
+            packets[numPackets].timestamp = datagram.timestamp;
+            cursor += len;
+            numPackets++;
+            nextPending++;
+        }
+
+        updateReadiness();
+        return numPackets;
+    }
+
+
+    void LinuxUDPTransceiver::sendPackets(const SerialConstIoVec *packets, size_t numPackets)
+    {
+        size_t sent = 0;
+        while(sent < numPackets)
+        {
+            //runs of equal-size datagrams go down the stack as one segmented send when gso is on. the datagrams up
+            //to the next such run go out as a plain batch
+            size_t numSent;
+            size_t numRun = (gsoEnabled ? gsoRunLength(&packets[sent], numPackets - sent) : 1);
+            if(numRun > 1)
+            {
+                numSent = sendSegmented(&packets[sent], numRun);
+            } else
+            {
+                size_t numSingles = 1;
+                while(gsoEnabled && sent + numSingles < numPackets && gsoRunLength(&packets[sent + numSingles], numPackets - sent - numSingles) == 1)
+                {
+                    numSingles++;
+                }
+
+                numSent = sendBatch(&packets[sent], (gsoEnabled ? numSingles : numPackets - sent));
+            }
+
+            if(numSent == 0)
+            {
+                SERLIB_LOG_ERROR("Send to %s failed, dropping %d of %d datagrams", address.c_str(), (int) (numPackets - sent), (int) numPackets);
+                dropped += numPackets - sent;
+                return;
+            }
+
+            sent += numSent;
+        }
+    }
+
+
+    uint64_t LinuxUDPTransceiver::droppedDatagrams(void) const
+    {
+        return dropped;
+    }
+
+
+    bool LinuxUDPTransceiver::waitForData(double timeoutSeconds)
+    {
+        //datagrams from the last recvmmsg() may still be waiting
+        if(nextPending < pending.size())
+        {
+            return true;
+        }
+
+        return SerialTransceiver::waitForData(timeoutSeconds);
+    }
+
+
+    unsigned int LinuxUDPTransceiver::capabilities(void) const
+    {
+        return TRANSCEIVER_CAP_VECTORED_IO | TRANSCEIVER_CAP_NATIVE_HANDLE | TRANSCEIVER_CAP_MESSAGE_BOUNDARIES;
+    }
+
+
+    NativeHandle LinuxUDPTransceiver::nativeHandle(void) const
+    {
+        return (pollSet >= 0 ? pollSet : sock);
+    }
+
+
+    size_t LinuxUDPTransceiver::outputBacklog(void) const
+    {
+        //the handle may be the epoll set, which has no send queue
+        int queued = 0;
+        if(sock >= 0 && ioctl(sock, TIOCOUTQ, &queued) == 0 && queued > 0)
+        {
+            return queued;
+        }
+
+        return 0;
+    }
+
+
+    void LinuxUDPTransceiver::updateReadiness(void)
+    {
+        if(pendingEvent < 0)
+        {
+            return;
+        }
+
+        if(nextPending < pending.size())
+        {
+            eventfd_write(pendingEvent, 1);
+        } else
+        {
+            eventfd_t count;
+            eventfd_read(pendingEvent, &count);
+        }
+    }
+
+
+    void LinuxUDPTransceiver::closeReadiness(void)
+    {
+        if(pollSet >= 0)
+        {
+            close(pollSet);
+            pollSet = -1;
+        }
+
+        if(pendingEvent >= 0)
+        {
+            close(pendingEvent);
+            pendingEvent = -1;
+        }
+    }
+
+
+    bool LinuxUDPTransceiver::usingSlots(void) const
+    {
+        //timestamps come with the control messages, which only the slots have room for
+        return options.batchSize > 1 || options.useGro || options.receiveTimestamps;
+    }
+
+
+    bool LinuxUDPTransceiver::fillSlots(void)
+    {
+        pending.clear();
+        nextPending = 0;
+
+        for(size_t i = 0; i < slotHeaders.size(); i++)
+        {
+            slotHeaders[i].msg_hdr.msg_control = &slotControl[i * UDP_SLOT_CONTROL_SIZE];
+            slotHeaders[i].msg_hdr.msg_controllen = UDP_SLOT_CONTROL_SIZE;
+        }
+
+        //blocks for the first datagram (up to the receive timeout), then takes whatever else is queued
+        int ret = ::recvmmsg(sock, slotHeaders.data(), slotHeaders.size(), MSG_WAITFORONE, nullptr);
+        if(ret == -1)
+        {
+            if(errno != EAGAIN)
+            {
+                SERLIB_LOG_DEBUG("recvmmsg() from %s failed (%d) : %s", address.c_str(), errno, strerror(errno));
+            }
+
+            return false;
+        }
+
+        for(int i = 0; i < ret; i++)
+        {
+            msghdr& hdr = slotHeaders[i].msg_hdr;
+            if(hdr.msg_flags & MSG_TRUNC)
+            {
+                SERLIB_LOG_ERROR("Datagram from %s was larger than %zu bytes and was truncated", address.c_str(), slotSize);
+            }
+
+            //a merged datagram carries the size of the datagrams it was made from
+            size_t segmentSize = slotHeaders[i].msg_len;
+            Time timestamp;
+            for(cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+            {
+                if(cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+                {
+                    int gsoSize;
+                    memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof(gsoSize));
+                    if(gsoSize > 0)
+                    {
+                        segmentSize = gsoSize;
+                    }
+                } else if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    //the kernel stamps with the wall clock
+                    timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    timestamp = fromSystemTime(std::chrono::system_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec))));
+                }
+            }
+
+            size_t base = i * slotSize;
+            for(size_t offset = 0; offset < slotHeaders[i].msg_len; offset += segmentSize)
+            {
+                SerialPacketInfo datagram;
+                datagram.offset = base + offset;
+                datagram.length = std::min(segmentSize, (size_t) slotHeaders[i].msg_len - offset);
+                datagram.timestamp = timestamp;
+                pending.push_back(datagram);
+            }
+        }
+
+        return !pending.empty();
+    }
+
+
+    size_t LinuxUDPTransceiver::sendBatch(const SerialConstIoVec *packets, size_t numPackets)
+    {
+        mmsghdr headers[MAX_PACKET_BATCH];
+        iovec iovs[MAX_PACKET_BATCH];
+        size_t numBatch = std::min(std::min(std::max(options.batchSize, (size_t) 1), (size_t) MAX_PACKET_BATCH), numPackets);
+        for(size_t i = 0; i < numBatch; i++)
+        {
+            iovs[i].iov_base = (void *) packets[i].data;
+            iovs[i].iov_len = packets[i].numData;
+            memset(&headers[i], 0, sizeof(headers[i]));
+            headers[i].msg_hdr.msg_iov = &iovs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int ret = ::sendmmsg(sock, headers, numBatch, 0);
+        if(ret <= 0)
+        {
+            SERLIB_LOG_DEBUG("sendmmsg() to %s failed: %s", address.c_str(), strerror(errno));
+            return 0;
+        }
+
+        return ret;
+    }
+
+
+    size_t LinuxUDPTransceiver::sendSegmented(const SerialConstIoVec *packets, size_t numPackets)
+    {
+        iovec iovs[UDP_MAX_GSO_SEGMENTS];
+        for(size_t i = 0; i < numPackets; i++)
+        {
+            iovs[i].iov_base = (void *) packets[i].data;
+            iovs[i].iov_len = packets[i].numData;
+        }
+
+        char control[CMSG_SPACE(sizeof(uint16_t))];
+        memset(control, 0, sizeof(control));
+
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iovs;
+        msg.msg_iovlen = numPackets;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        //the stack cuts the payload back into datagrams of this size
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t segmentSize = packets[0].numData;
+        memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+
+        if(::sendmsg(sock, &msg, 0) == -1)
+        {
+            if(errno == EINVAL || errno == EIO || errno == ENOPROTOOPT)
+            {
+                //kernel or device cannot segment. send these one by one from now on
+                SERLIB_LOG_ERROR("UDP_SEGMENT send to %s failed: %s. Disabling GSO", address.c_str(), strerror(errno));
+                gsoEnabled = false;
+                return sendBatch(packets, numPackets);
+            }
+
+            SERLIB_LOG_ERROR("UDP_SEGMENT send to %s failed: %s", address.c_str(), strerror(errno));
+            return 0;
+        }
+
+        return numPackets;
     }
 }
 
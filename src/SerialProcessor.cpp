@@ -1,5 +1,11 @@
 #include "serial_library/serial_library.hpp"
 
+// how long the receive thread sleeps on the transceiver before checking whether it was stopped
+#define RECEIVE_THREAD_WAIT_NS 10000000
+
+// how long it backs off after an update that got nothing from a transceiver which cannot wait for data
+#define RECEIVE_THREAD_IDLE_NS 1000000
+
 namespace serial_library
 {
     SerialProcessor::SerialProcessor(
@@ -14,13 +20,29 @@ namespace serial_library
        failedOfLastTenCounter(0),
        totalOfLastTenCounter(0),
        msgBufferCursorPos(0),
+       byteTime(0),
+       packetMode(false),
        syncValueLen(syncValueLen),
        frameMap(frames),
        defaultFrame(defaultFrame),
        switchEndianness(switchEndianness),
        callbacks(callbacks),
        debugName(debugName),
-       valueMapResource(std::make_unique<SerialValuesMap>())
+       valueMapResource(std::make_unique<SerialValuesMap>()),
+       receiving(false),
+       receiveGeneration(0),
+       loopGeneration(0),
+       loopThread(std::thread::id()),
+       bytesReceived(0),
+       numDecoded(0),
+       numPendingRequests(0),
+       nextRequestId(0),
+       numFrameListeners(0),
+       nextListenerId(0),
+       numQueuedSends(0),
+       nextSendSequence(0),
+       outputBudgetBytes(SIZE_MAX),
+       outputBudgetSeconds(-1)
     {
         ctorFunc(syncValue, syncValueLen);
     }
@@ -38,6 +60,8 @@ namespace serial_library
        failedOfLastTenCounter(0),
        totalOfLastTenCounter(0),
        msgBufferCursorPos(0),
+       byteTime(0),
+       packetMode(false),
        syncValueLen(syncValueLen),
        frameMap(frames),
        defaultFrame(defaultFrame),
@@ -45,7 +69,21 @@ namespace serial_library
        callbacks(callbacks),
        debugName(debugName),
        valueMapResource(std::make_unique<SerialValuesMap>()),
-       transceiverResource(std::move(transceivr))
+       transceiverResource(std::move(transceivr)),
+       receiving(false),
+       receiveGeneration(0),
+       loopGeneration(0),
+       loopThread(std::thread::id()),
+       bytesReceived(0),
+       numDecoded(0),
+       numPendingRequests(0),
+       nextRequestId(0),
+       numFrameListeners(0),
+       nextListenerId(0),
+       numQueuedSends(0),
+       nextSendSequence(0),
+       outputBudgetBytes(SIZE_MAX),
+       outputBudgetSeconds(-1)
     {
         ctorFunc(syncValue, syncValueLen);
     }
@@ -53,6 +91,15 @@ namespace serial_library
 
     SerialProcessor::~SerialProcessor()
     {
+        //the last reference went away on the receive thread, which cannot join itself
+        if(loopThread == std::this_thread::get_id())
+        {
+            receiving = false;
+            receiveGeneration++;
+            receiveThread.detach();
+        }
+
+        stop();
         SerialTransceiver::UniquePtr transceiver = transceiverResource.lockResource();
         if(transceiver)
         {
@@ -73,6 +120,8 @@ namespace serial_library
 
     void SerialProcessor::setTransceiver(SerialTransceiver::UniquePtr& transceiver)
     {
+        //the receive thread may be waiting on the old one
+        std::lock_guard<std::mutex> waitGuard(transceiverWaitLock);
         SerialTransceiver::UniquePtr activeTransceiver = transceiverResource.lockResource();
 
         if(activeTransceiver.get() != nullptr)
@@ -107,6 +156,7 @@ namespace serial_library
     void SerialProcessor::resetTransceiver()
     {
         SERLIB_LOG_INFO("%s: resetting transceiver", debugName.c_str());
+        std::lock_guard<std::mutex> waitGuard(transceiverWaitLock);
         SerialTransceiver::UniquePtr activeTransceiver = transceiverResource.lockResource();
         
         if(activeTransceiver != nullptr)
@@ -119,8 +169,27 @@ namespace serial_library
     }
 
 
+    NativeHandle SerialProcessor::nativeHandle()
+    {
+        SerialTransceiver::UniquePtr transceiver = transceiverResource.lockResource();
+        NativeHandle handle = (transceiver ? transceiver->nativeHandle() : INVALID_NATIVE_HANDLE);
+        transceiverResource.unlockResource(std::move(transceiver));
+        return handle;
+    }
+
+
     void SerialProcessor::update(const Time& now)
     {
+        if(numPendingRequests > 0)
+        {
+            expireRequests();
+        }
+
+        if(numQueuedSends > 0)
+        {
+            flushSendQueue();
+        }
+
         //TODO can probably rewrite method and use SERIAL_LIB_ASSERT
         SerialTransceiver::UniquePtr transceiver = transceiverResource.lockResource();
         
@@ -136,25 +205,66 @@ namespace serial_library
             return;
         }
 
-        size_t recvd = transceiver->recv(updateTransmissionBuffer, PROCESSOR_BUFFER_SIZE);
-        SERLIB_LOG_DEBUG("%s: Received %d bytes", debugName.c_str(), recvd);
+        // the sync is at the same offset in every frame, so the default frame tells us where messages start
+        const SerialFrame& defaultFrameLayout = frameMap.at(defaultFrame);
+        size_t msgStartOffsetFromSync = findit(defaultFrameLayout.begin(), defaultFrameLayout.end(), FIELD_SYNC) - defaultFrameLayout.begin();
+        SerialPacketInfo packets[MAX_PACKET_BATCH];
+        byteTime = transceiver->secondsPerByte();
+
+        if(packetMode)
+        {
+            //every message arrives whole and starts with a frame, so nothing is kept between updates
+            size_t numPackets = transceiver->recvPackets(msgBuffer, PROCESSOR_BUFFER_SIZE, packets, MAX_PACKET_BATCH);
+            transceiverResource.unlockResource(std::move(transceiver));
+            SERLIB_LOG_DEBUG("%s: Received %d messages", debugName.c_str(), numPackets);
+            bytesReceived += numPackets;
+
+            for(size_t i = 0; i < numPackets; i++)
+            {
+                Time arrival = (packets[i].timestamp != Time() ? packets[i].timestamp : now);
+                decodePacket(msgBuffer + packets[i].offset, packets[i].length, msgStartOffsetFromSync, arrival);
+            }
+
+            return;
+        }
+
+        if(msgBufferCursorPos >= PROCESSOR_BUFFER_SIZE)
+        {
+            //buffer is full of bytes that never formed a message. drop them to make room
+            SERLIB_LOG_ERROR("%s: Message buffer overflowed, dropping %d bytes", debugName.c_str(), msgBufferCursorPos);
+            msgBufferCursorPos = 0;
+            arrivalMarks.clear();
+        }
+
+        // receive directly onto the end of the message buffer. transceivers that batch can hand over several messages at once
+        size_t 
+            numPackets = transceiver->recvPackets(&msgBuffer[msgBufferCursorPos], PROCESSOR_BUFFER_SIZE - msgBufferCursorPos, packets, MAX_PACKET_BATCH),
+            recvd = (numPackets > 0 ? packets[numPackets - 1].offset + packets[numPackets - 1].length : 0);
+        
+        SERLIB_LOG_DEBUG("%s: Received %d bytes in %d messages", debugName.c_str(), recvd, numPackets);
 
         transceiverResource.unlockResource(std::move(transceiver));
+        bytesReceived += recvd;
 
         if(recvd == 0)
         {
             return;
         }
 
-        // append new contents to buffer
-        size_t bytesToCopy = recvd;
-        if(msgBufferCursorPos + recvd > PROCESSOR_BUFFER_SIZE)
+        //remember when each message arrived, so that frames are stamped with the arrival of their first byte
+        for(size_t i = 0; i < numPackets; i++)
         {
-            bytesToCopy = PROCESSOR_BUFFER_SIZE - msgBufferCursorPos;
+            SerialPacketInfo mark = packets[i];
+            mark.offset += msgBufferCursorPos;
+            if(mark.timestamp == Time())
+            {
+                mark.timestamp = now;
+            }
+
+            arrivalMarks.push_back(mark);
         }
 
-        memcpy(&msgBuffer[msgBufferCursorPos], updateTransmissionBuffer, bytesToCopy);
-        msgBufferCursorPos += bytesToCopy;
+        msgBufferCursorPos += recvd;
 
         char *syncLocation = nullptr;
         do
@@ -165,155 +275,335 @@ namespace serial_library
                 return;
             }
 
-            // can process message here. first need to figure out the frame to use.
-            // if there was only one frame provided, this is easy. otherwise, need to look for indication in the message
-            SerialFrame frameToUse = frameMap.at(defaultFrame);
+            totalOfLastTenCounter++;
+
             size_t
-                frameMapSz = frameMap.size(),
-                frameSz = frameToUse.size();
+                syncOffsetFromBuffer = syncLocation - msgBuffer,
+                frameLen = 0;
+
+            char *msgEnd = syncLocation + 1;
+            FrameDecodeResult result = FRAME_INVALID;
+
+            //a sync too close to the start of the buffer cannot belong to a complete message
+            if(msgStartOffsetFromSync <= syncOffsetFromBuffer)
+            {
+                char *msgStart = syncLocation - msgStartOffsetFromSync;
+                result = decodeFrame(msgStart, msgBufferCursorPos - (msgStart - msgBuffer), arrivalTime(msgStart - msgBuffer, now), frameLen);
+                msgEnd = msgStart + frameLen;
+            }
+
+            if(result == FRAME_INCOMPLETE)
+            {
+                //we dont have enough information to parse the frame yet. wait for more data
+                break;
+            }
+
+            if(result == FRAME_INVALID)
+            {
+                //message bad. dont remove like normal, just delete through the sync character
+                SERLIB_LOG_DEBUG("%s: Skipping message because it failed some checks", debugName.c_str());
+                msgEnd = syncLocation + 1;
+            }
+
+            updateFailureStats(result == FRAME_INVALID);
+
+            //remove message from the buffer
+            size_t amountRemoved = msgEnd - msgBuffer;
+            if(amountRemoved < msgBufferCursorPos)
+            {
+                memmove(msgBuffer, msgEnd, msgBufferCursorPos - amountRemoved);
+                msgBufferCursorPos -= amountRemoved;
+                consumeArrivalMarks(amountRemoved);
+            } else
+            {
+                msgBufferCursorPos = 0;
+                arrivalMarks.clear();
+            }
+
+        } while(syncLocation);
+    }
+
+
+    Time SerialProcessor::arrivalTime(size_t offset, const Time& now) const
+    {
+        //the byte arrived with the last message that started at or before it
+        Time arrival = now;
+        for(size_t i = 0; i < arrivalMarks.size() && arrivalMarks[i].offset <= offset; i++)
+        {
+            const SerialPacketInfo& mark = arrivalMarks[i];
+            arrival = mark.timestamp;
+
+            //a read completes when its last byte is in, and the bytes before it came in one character time apart.
+            //this cannot go back past the read before it, which already had everything that arrived by then
+            size_t markEnd = mark.offset + mark.length;
+            if(byteTime > 0 && offset + 1 < markEnd)
+            {
+                std::chrono::duration<double> backdate(byteTime * (markEnd - offset - 1));
+                arrival = std::max(
+                    arrival - std::chrono::duration_cast<Time::duration>(backdate),
+                    (i > 0 ? arrivalMarks[i - 1].timestamp : Time()));
+            }
+        }
+
+        return arrival;
+    }
+
+
+    void SerialProcessor::consumeArrivalMarks(size_t amountRemoved)
+    {
+        //keep the mark that covers the first byte left in the buffer
+        size_t numDropped = 0;
+        while(numDropped + 1 < arrivalMarks.size() && arrivalMarks[numDropped + 1].offset <= amountRemoved)
+        {
+            numDropped++;
+        }
 
-            //determine the message string based on the sync location. then process it
+        arrivalMarks.erase(arrivalMarks.begin(), arrivalMarks.begin() + numDropped);
+        for(SerialPacketInfo& mark : arrivalMarks)
+        {
+            //the mark's removed bytes are gone from its length too
+            size_t cut = std::min(mark.offset + mark.length, amountRemoved);
+            mark.length -= (cut > mark.offset ? cut - mark.offset : 0);
+            mark.offset = (mark.offset > amountRemoved ? mark.offset - amountRemoved : 0);
+        }
+    }
 
-            int
-                msgStartOffsetFromSync = findit(frameToUse.begin(), frameToUse.end(), FIELD_SYNC) - frameToUse.begin(),
-                syncOffsetFromBuffer = syncLocation - msgBuffer;
 
-            char 
-                *msgStart = syncLocation,
-                *msgEnd = msgBuffer + msgBufferCursorPos;
+    void SerialProcessor::decodePacket(const char *packet, size_t packetLen, size_t msgStartOffsetFromSync, const Time& now)
+    {
+        //frames sit back to back from the start of the message, and must use all of it
+        size_t pos = 0;
+        while(pos < packetLen)
+        {
+            const char *msgStart = packet + pos;
+            size_t 
+                remaining = packetLen - pos,
+                frameLen = 0;
+            
+            FrameDecodeResult result = FRAME_INVALID;
+            if(remaining >= msgStartOffsetFromSync + syncValueLen && memcmp(msgStart + msgStartOffsetFromSync, syncValue, syncValueLen) == 0)
+            {
+                result = decodeFrame(msgStart, remaining, now, frameLen);
+            }
 
             totalOfLastTenCounter++;
+            updateFailureStats(result != FRAME_DECODED);
+            if(result != FRAME_DECODED)
+            {
+                SERLIB_LOG_DEBUG("%s: Dropping the last %d bytes of a message because they are not a whole frame", debugName.c_str(), remaining);
+                return;
+            }
+
+            pos += frameLen;
+        }
+    }
+
+
+    void SerialProcessor::updateFailureStats(bool failed)
+    {
+        if(failed)
+        {
+            failedOfLastTenCounter++;
+        }
+
+        if(totalOfLastTenCounter >= 10)
+        {
+            failedOfLastTen = failedOfLastTenCounter;
+            failedOfLastTenCounter = 0;
+            totalOfLastTenCounter = 0;
+        }
+    }
+
 
-            msgStart = syncLocation - msgStartOffsetFromSync;
+    SerialProcessor::FrameDecodeResult SerialProcessor::decodeFrame(const char *msgStart, size_t msgLen, const Time& now, size_t& frameLen)
+    {
+        // can process message here. first need to figure out the frame to use.
+        // if there was only one frame provided, this is easy. otherwise, need to look for indication in the message
+        SerialFrameId frameId = defaultFrame;
+        const SerialFrame *frameToUse = &frameMap.at(defaultFrame);
+        bool isDelta = false;
+
+        //check that we can parse for a frame id. delta frames may be shorter than the default frame, so only require its header
+        if(msgLen < deltaFrameHeaderLength(*frameToUse))
+        {
+            SERLIB_LOG_DEBUG("%s: Waiting for more data because the message is shorter than the frame header (not enough info to parse)", debugName.c_str());
+            return FRAME_INCOMPLETE;
+        }
 
-            //check that we can parse for a frame id
-            if(msgBufferCursorPos < frameSz)
+        //parse for a frame id if multiple frames exist or if the default frame contains a frame field
+        if(frameMap.size() > 1 || findit(frameToUse->begin(), frameToUse->end(), FIELD_FRAME) != frameToUse->end())
+        {
+            char frameIdBuf[MAX_DATA_BYTES] = {0};
+            size_t bytes = extractFieldFromBuffer(msgStart, msgLen, *frameToUse, FIELD_FRAME, frameIdBuf, MAX_DATA_BYTES);
+            if(bytes > 0)
             {
-                SERLIB_LOG_DEBUG("%s: Dropping message because cursor position is less than the size of the default frame (not enough info to parse)", debugName.c_str());
-                //we dont have enough information to parse the default frame for a frame id.
-                break;
+                frameId = convertFromCString<SerialFrameId>(frameIdBuf, bytes);
+                SERLIB_LOG_DEBUG("Received frame with id %d", frameId);
+
+                if(frameMap.find(frameId) != frameMap.end())
+                {
+                    frameToUse = &frameMap.at(frameId);
+                } else if((frameId & DELTA_FRAME_FLAG) && decodesDelta(frameId & ~DELTA_FRAME_FLAG))
+                {
+                    frameId &= ~DELTA_FRAME_FLAG;
+                    frameToUse = &frameMap.at(frameId);
+                    isDelta = true;
+                } else
+                {
+                    return FRAME_INVALID;
+                }
+            }
+        }
+
+        bool hasChecksum = findit(frameToUse->begin(), frameToUse->end(), FIELD_CHECKSUM) != frameToUse->end();
+        vector<SerialFieldId> deltaFields;
+        size_t
+            headerLen = 0,
+            bitmapLen = 0;
+        
+        // determine the length of the frame now that we have selected the frame to use
+        if(isDelta)
+        {
+            deltaFields = deltaFrameFields(*frameToUse);
+            headerLen = deltaFrameHeaderLength(*frameToUse);
+            bitmapLen = (deltaFields.size() + 7) / 8;
+            if(msgLen < headerLen + bitmapLen)
+            {
+                return FRAME_INCOMPLETE;
             }
 
-            //parse for a frame id if multiple frames exist or if the default frame contains a frame field
-            bool hasFrameToUse = true;
-            if(frameMapSz > 1 || findit(frameToUse.begin(), frameToUse.end(), FIELD_FRAME) != frameToUse.end())
+            frameLen = headerLen + bitmapLen + (hasChecksum ? sizeof(Checksum) : 0);
+            for(size_t i = 0; i < deltaFields.size(); i++)
             {
-                char frameIdBuf[MAX_DATA_BYTES] = {0};
-                size_t bytes = extractFieldFromBuffer(msgStart, msgBufferCursorPos, frameToUse, FIELD_FRAME, frameIdBuf, MAX_DATA_BYTES);
-                if(bytes > 0)
+                if(msgStart[headerLen + i / 8] & (1 << (i % 8)))
                 {
-                    SerialFrameId frameId = convertFromCString<SerialFrameId>(frameIdBuf, bytes);
-                    SERLIB_LOG_DEBUG("Received frame with id %d", frameId);
-
-                    if(frameMap.find(frameId) == frameMap.end())
-                    {
-                        hasFrameToUse = false;
-                    } else
-                    {
-                        frameToUse = frameMap.at(frameId);
-                        
-                        //check if the frame is parsable
-                        frameSz = frameToUse.size();
-                        if(msgBufferCursorPos < frameSz)
-                        {
-                            //we dont have enough information to parse this frame
-                            SERLIB_LOG_DEBUG("%s: Dropping message because cursor position is less than the size of the selected frame", debugName.c_str());
-                            break;
-                        }
-                    }
+                    frameLen += countit(frameToUse->begin(), frameToUse->end(), deltaFields[i]);
                 }
             }
+        } else
+        {
+            frameLen = frameToUse->size();
+        }
 
-            // now define end of frame now that we have selected the frame to use
-            msgEnd = msgStart + frameSz;
+        if(msgLen < frameLen)
+        {
+            //we dont have enough information to parse this frame
+            SERLIB_LOG_DEBUG("%s: Waiting for more data because the message is shorter than the selected frame", debugName.c_str());
+            return FRAME_INCOMPLETE;
+        }
 
-            bool msgPassesUserTest = true;
-            if(set<SerialFieldId>(frameToUse.begin(), frameToUse.end()).count(FIELD_CHECKSUM) > 0)
+        if(hasChecksum)
+        {
+            bool msgPassesUserTest = false;
+            if(isDelta)
+            {
+                //delta frames carry their checksum at the end
+                Checksum checksum = convertFromCString<Checksum>(msgStart + frameLen - sizeof(Checksum), sizeof(Checksum));
+                msgPassesUserTest = callbacks.checksumEvaluationFunc(msgStart, frameLen - sizeof(Checksum), checksum);
+            } else
             {
                 //grab checksum out of message
-                size_t csLen = extractFieldFromBuffer(msgStart, msgBufferCursorPos, frameToUse, FIELD_CHECKSUM, fieldBuf, sizeof(fieldBuf));
+                size_t csLen = extractFieldFromBuffer(msgStart, msgLen, *frameToUse, FIELD_CHECKSUM, fieldBuf, sizeof(fieldBuf));
                 Checksum checksum = convertFromCString<Checksum>(fieldBuf, csLen);
 
                 //remove checksum from message
-                memcpy(updateChecksumlessBuffer, msgStart, msgBufferCursorPos);
-                deleteChecksumFromBuffer(updateChecksumlessBuffer, msgBufferCursorPos, frameToUse);
+                memcpy(updateChecksumlessBuffer, msgStart, frameLen);
+                deleteChecksumFromBuffer(updateChecksumlessBuffer, frameLen, *frameToUse);
 
                 //pass edited message to user function to evaluate checksum
-                msgPassesUserTest = callbacks.checksumEvaluationFunc(updateChecksumlessBuffer, frameToUse.size() - sizeof(Checksum), checksum);
+                msgPassesUserTest = callbacks.checksumEvaluationFunc(updateChecksumlessBuffer, frameLen - sizeof(Checksum), checksum);
             }
 
-            if(msgStartOffsetFromSync <= syncOffsetFromBuffer && msgPassesUserTest && hasFrameToUse)
+            if(!msgPassesUserTest)
             {
-                SERLIB_LOG_DEBUG("%s: Processing message with frame because it passed all checks", debugName.c_str());
-
-                //iterate through frame and find all unknown fields
-                for(auto it = frameToUse.begin(); it != frameToUse.end(); it++)
-                {
-                    std::unique_ptr<SerialValuesMap> values = valueMapResource.lockResource();
-                    if(values->find(*it) == values->end())
-                    {
-                        values->insert({ *it, SerialDataStamped() });
-                    }
+                return FRAME_INVALID;
+            }
+        }
 
-                    valueMapResource.unlockResource(std::move(values));
-                }
+        SERLIB_LOG_DEBUG("%s: Processing message with frame because it passed all checks", debugName.c_str());
 
-                //iterate through known fields and update their values from message
-                std::unique_ptr<SerialValuesMap> values = valueMapResource.lockResource();
-                SerialValuesMap msgValueMap;
-                for(auto it = values->begin(); it != values->end(); it++)
+        //extract every field carried by the message
+        SerialValuesMap msgValueMap;
+        if(isDelta)
+        {
+            SerialDataStamped serialData;
+            serialData.timestamp = now;
+            serialData.data = serialDataFromString(syncValue, syncValueLen);
+            msgValueMap.insert({ FIELD_SYNC, serialData });
+            serialData.data.numData = convertToCString<SerialFrameId>(frameId, serialData.data.data, MAX_DATA_BYTES);
+            msgValueMap.insert({ FIELD_FRAME, serialData });
+
+            const char *fieldData = msgStart + headerLen + bitmapLen;
+            for(size_t i = 0; i < deltaFields.size(); i++)
+            {
+                if(msgStart[headerLen + i / 8] & (1 << (i % 8)))
                 {
-                    memset(fieldBuf, 0, sizeof(fieldBuf));
-                    SerialFieldId field = it->first;
-                    size_t extracted = extractFieldFromBuffer(msgStart, frameSz, frameToUse, field, fieldBuf, sizeof(fieldBuf));
-                    if(extracted > 0)
-                    {
-                        SerialDataStamped serialData;
-                        serialData.timestamp = now;
-                        memcpy(serialData.data.data, fieldBuf, extracted);
-                        serialData.data.numData = extracted;
-
-                        it->second = serialData;
-
-                        msgValueMap.insert({ it->first, it->second });
-                    }
+                    size_t fieldLen = countit(frameToUse->begin(), frameToUse->end(), deltaFields[i]);
+                    serialData.data = serialDataFromString(fieldData, fieldLen);
+                    msgValueMap.insert({ deltaFields[i], serialData });
+                    fieldData += fieldLen;
                 }
+            }
 
-                valueMapResource.unlockResource(std::move(values));
-                
-                //call new message function
-                callbacks.newMessageCallback(msgValueMap);
-
-                //set lastmsg timestamp
-                lastMsgRecvTime = now;
-            } else
+            if(hasChecksum)
             {
-                //message bad. dont remove like normal, just delete through the sync character
-                SERLIB_LOG_DEBUG("%s: Skipping message because it failed some checks", debugName.c_str());
-                msgEnd = syncLocation + 1;
-                failedOfLastTenCounter++;
+                serialData.data = serialDataFromString(msgStart + frameLen - sizeof(Checksum), sizeof(Checksum));
+                msgValueMap.insert({ FIELD_CHECKSUM, serialData });
             }
-
-            if(totalOfLastTenCounter >= 10)
+        } else
+        {
+            set<SerialFieldId> frameFields(frameToUse->begin(), frameToUse->end());
+            for(SerialFieldId field : frameFields)
             {
-                failedOfLastTen = failedOfLastTenCounter;
-                failedOfLastTenCounter = 0;
-                totalOfLastTenCounter = 0;
+                memset(fieldBuf, 0, sizeof(fieldBuf));
+                size_t extracted = extractFieldFromBuffer(msgStart, frameLen, *frameToUse, field, fieldBuf, sizeof(fieldBuf));
+                if(extracted > 0)
+                {
+                    msgValueMap.insert({ field, serialDataStampedFromString(fieldBuf, extracted, now) });
+                }
             }
+        }
 
-            //remove message from the buffer
-            memmove(msgBuffer, msgEnd, PROCESSOR_BUFFER_SIZE - msgBufferCursorPos);
-            size_t amountRemoved = msgEnd - msgBuffer;
+        //update known fields from message
+        std::unique_ptr<SerialValuesMap> values = valueMapResource.lockResource();
+        for(auto it = msgValueMap.begin(); it != msgValueMap.end(); it++)
+        {
+            (*values)[it->first] = it->second;
+        }
 
-            if(amountRemoved < msgBufferCursorPos)
-            {
-                msgBufferCursorPos -= amountRemoved;
-            } else
+        //everything after this sees the whole frame, with the fields a delta frame left out at their last values
+        if(isDelta)
+        {
+            set<SerialFieldId> frameFields(frameToUse->begin(), frameToUse->end());
+            for(SerialFieldId field : frameFields)
             {
-                msgBufferCursorPos = 0;
+                auto it = values->find(field);
+                if(it != values->end())
+                {
+                    msgValueMap.insert(*it);
+                }
             }
+        }
 
-        } while(syncLocation);
+        valueMapResource.unlockResource(std::move(values));
+        
+        //call new message function
+        callbacks.newMessageCallback(msgValueMap);
+
+        //set lastmsg timestamp
+        lastMsgRecvTime = now;
+        if(numPendingRequests > 0)
+        {
+            completeRequests(frameId, msgValueMap);
+        }
+
+        if(numFrameListeners > 0)
+        {
+            callFrameListeners(frameId, msgValueMap);
+        }
+
+        notifyDecoded(frameId, msgValueMap);
+        return FRAME_DECODED;
     }
     
     
@@ -374,89 +664,922 @@ namespace serial_library
     }
     
     
+    void SerialProcessor::setFields(const map<SerialFieldId, SerialData>& fields, const Time& now)
+    {
+        std::unique_ptr<SerialValuesMap> values = valueMapResource.lockResource();
+        for(auto it = fields.begin(); it != fields.end(); it++)
+        {
+            SerialDataStamped& stampedData = (*values)[it->first];
+            stampedData.data = it->second;
+            stampedData.timestamp = now;
+        }
+
+        valueMapResource.unlockResource(std::move(values));
+    }
+
+
+    bool SerialProcessor::getFields(const vector<SerialFieldId>& fields, SerialValuesMap& out)
+    {
+        bool hasAll = true;
+        std::unique_ptr<SerialValuesMap> values = valueMapResource.lockResource();
+        for(SerialFieldId field : fields)
+        {
+            auto it = values->find(field);
+            if(it == values->end())
+            {
+                hasAll = false;
+                continue;
+            }
+
+            out[field] = (switchEndianness ? switchStampedDataEndianness(it->second) : it->second);
+        }
+
+        valueMapResource.unlockResource(std::move(values));
+        return hasAll;
+    }
+    
+    
     void SerialProcessor::send(const SerialFrameId& frameId)
     {
         SERLIB_LOG_DEBUG("%s sending frame %d", debugName.c_str(), frameId);
+        sendBatch({ frameId });
+    }
 
-        if(frameMap.find(frameId) == frameMap.end())
+
+    void SerialProcessor::sendBatch(const vector<SerialFrameId>& frameIds)
+    {
+        std::lock_guard<std::mutex> guard(sendLock);
+
+        //check that every frame can be encoded before encoding any of them. Otherwise a bad frame would leave the
+        //frames before it unsent, with their delta states already advanced. Fields are never removed, so the check
+        //holds until the frames are encoded
+        ProtectedResourceGuard<SerialValuesMap> values(valueMapResource);
+        for(const SerialFrameId& frameId : frameIds)
         {
-            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION(debugName + "Cannot send message with unknown frame id " + to_string(frameId));
+            checkSendable(frameId, values.acquire());
         }
 
-        memset(sendTransmissionBuffer, 0, sizeof(sendTransmissionBuffer));
-        SerialFrame frame = frameMap.at(frameId);
-
-        //loop through minimal set of frames and pack each frame into the transmission buffer
-        set<SerialFieldId> frameSet(frame.begin(), frame.end());
-        for(auto fieldIt = frameSet.begin(); fieldIt != frameSet.end(); fieldIt++)
+        vector<EncodedFrame> encoded; // frames in the transmission buffer, checksummed just before they are written
+        map<SerialFrameId, DeltaEncodingState> sentDeltaStates; // delta states of those frames, kept once they are written
+        size_t batchLen = 0;
+        for(size_t i = 0; i <= frameIds.size(); i++)
         {
-            SerialData dataToInsert;
-            std::unique_ptr<SerialValuesMap> values = valueMapResource.lockResource();
-            
-            //couldnt find the field included in the frame. Check if the frame is a builtin type
-            if(*fieldIt == FIELD_SYNC)
+            //flush when the next frame might not fit, and once all frames are encoded
+            bool flush = (i == frameIds.size());
+            if(!flush)
             {
-                memcpy(dataToInsert.data, syncValue, syncValueLen);
-                dataToInsert.numData = syncValueLen;
-            } else if(*fieldIt == FIELD_FRAME)
+                size_t frameSz = frameMap.at(frameIds[i]).size();
+                flush = batchLen + frameSz + (frameSz + 7) / 8 > sizeof(sendTransmissionBuffer);
+            }
+
+            if(flush && batchLen > 0)
             {
-                dataToInsert.numData = convertToCString<SerialFrameId>(frameId, dataToInsert.data, MAX_DATA_BYTES);
-            } else if(*fieldIt == FIELD_CHECKSUM)
+                //checksum callbacks and the write run without the values held, so that callbacks can read fields and
+                //decoding can go on
+                values.release();
+                for(const EncodedFrame& frame : encoded)
+                {
+                    insertChecksum(frame, &sendTransmissionBuffer[frame.offset]);
+                }
+
+                encoded.clear();
+                SerialTransceiver::UniquePtr transceiver = transceiverResource.lockResource();
+
+                if(!transceiver)
+                {
+                    SERLIB_LOG_ERROR("%s: Transceiver is NULL for some reason", debugName.c_str());
+                    transceiverResource.unlockResource(std::move(transceiver));
+                    return;
+                }
+
+                transceiver->send(sendTransmissionBuffer, batchLen);
+                transceiverResource.unlockResource(std::move(transceiver));
+                for(auto it = sentDeltaStates.begin(); it != sentDeltaStates.end(); it++)
+                {
+                    deltaStates[it->first] = it->second;
+                }
+
+                sentDeltaStates.clear();
+                batchLen = 0;
+            }
+
+            if(i < frameIds.size())
             {
-                valueMapResource.unlockResource(std::move(values));
-                continue;
-            } else if(values->find(*fieldIt) != values->end())
+                //every frame in a write is encoded under one lock, so none of them mixes values from before and after
+                //a setFields() or a decode
+                EncodedFrame frame;
+                frame.frameId = frameIds[i];
+                frame.offset = batchLen;
+                frame.length = encodeFrameForSend(frameIds[i], values.acquire(), sentDeltaStates, &sendTransmissionBuffer[batchLen], sizeof(sendTransmissionBuffer) - batchLen, frame.delta);
+                encoded.push_back(frame);
+                batchLen += frame.length;
+            }
+        }
+    }
+
+
+    void SerialProcessor::queueSend(const SerialFrameId& frameId, int priority)
+    {
+        if(frameMap.find(frameId) == frameMap.end())
+        {
+            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION(debugName + "Cannot queue message with unknown frame id " + to_string(frameId));
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(sendQueueLock);
+            auto it = sendQueue.find(frameId);
+            if(it == sendQueue.end())
             {
-                dataToInsert = values->at(*fieldIt).data;
+                sendQueue[frameId] = QueuedSend{ priority, nextSendSequence++ };
             } else
             {
-                //if it is a custom type, throw exception because it is undefined
-                valueMapResource.unlockResource(std::move(values));
-                THROW_NON_FATAL_SERIAL_LIB_EXCEPTION(debugName + "Cannot send serial frame " + std::to_string(frameId) + " because it is missing field " + to_string(*fieldIt));
+                it->second.priority = std::max(it->second.priority, priority);
             }
 
-            insertFieldToBuffer(
-                sendTransmissionBuffer, 
-                sizeof(sendTransmissionBuffer), 
-                frame, 
-                *fieldIt, 
-                dataToInsert.data,
-                dataToInsert.numData);
-            
-            valueMapResource.unlockResource(std::move(values));
+            numQueuedSends = sendQueue.size();
         }
 
-        //now remove checksum bytes from message, compute checksum, and add it to the message
-        if(frameSet.count(FIELD_CHECKSUM) > 0)
-        {
-            //fill checksum buffer with contents of transmission buffer
-            memcpy(sendChecksumlessBuffer, sendTransmissionBuffer, sizeof(sendTransmissionBuffer));
-            deleteChecksumFromBuffer(sendChecksumlessBuffer, sizeof(sendChecksumlessBuffer), frame);
-            Checksum checksum = callbacks.checksumGenerationFunc(sendChecksumlessBuffer, frame.size() - sizeof(Checksum));
-            
-            //fill checksum buffer with encoded checksum
-            size_t checksumLen = convertToCString<Checksum>(checksum, sendChecksumlessBuffer, sizeof(sendChecksumlessBuffer));
+        flushSendQueue();
+    }
 
-            insertFieldToBuffer(
-                sendTransmissionBuffer,
-                sizeof(sendTransmissionBuffer),
-                frame,
-                FIELD_CHECKSUM,
-                sendChecksumlessBuffer,
-                checksumLen);
+
+    size_t SerialProcessor::flushSendQueue(void)
+    {
+        //whoever is flushing already will send what it can. the rest goes out on the next update
+        std::unique_lock<std::mutex> flushGuard(flushLock, std::try_to_lock);
+        if(!flushGuard.owns_lock() || numQueuedSends == 0)
+        {
+            return 0;
         }
 
         SerialTransceiver::UniquePtr transceiver = transceiverResource.lockResource();
-
         if(!transceiver)
         {
-            SERLIB_LOG_ERROR("%s: Transceiver is NULL for some reason", debugName.c_str());
             transceiverResource.unlockResource(std::move(transceiver));
-            return;
+            return 0;
         }
 
-        transceiver->send(sendTransmissionBuffer, frame.size());
+        size_t backlog = transceiver->outputBacklog();
+        double secondsPerByte = transceiver->secondsPerByte();
         transceiverResource.unlockResource(std::move(transceiver));
+
+        vector<SerialFrameId> frameIds;
+        {
+            std::lock_guard<std::mutex> guard(sendQueueLock);
+            size_t budget = outputBudgetBytes;
+            if(outputBudgetSeconds >= 0 && secondsPerByte > 0)
+            {
+                budget = std::min(budget, (size_t) (outputBudgetSeconds / secondsPerByte + 0.5));
+            }
+
+            vector<pair<QueuedSend, SerialFrameId>> order;
+            order.reserve(sendQueue.size());
+            for(auto it = sendQueue.begin(); it != sendQueue.end(); it++)
+            {
+                order.push_back({ it->second, it->first });
+            }
+
+            std::sort(order.begin(), order.end(), [] (const pair<QueuedSend, SerialFrameId>& a, const pair<QueuedSend, SerialFrameId>& b) {
+                return (a.first.priority != b.first.priority ? a.first.priority > b.first.priority : a.first.sequence < b.first.sequence);
+            });
+
+            //stop at the first frame that does not fit, so lower priorities never hold up a higher one. a frame larger
+            //than the whole budget still goes out once the link is idle
+            size_t room = (backlog < budget ? budget - backlog : 0);
+            for(size_t i = 0; i < order.size(); i++)
+            {
+                size_t frameSz = frameMap.at(order[i].second).size();
+                if(frameSz > room && !(frameIds.empty() && backlog == 0))
+                {
+                    break;
+                }
+
+                room -= std::min(frameSz, room);
+                frameIds.push_back(order[i].second);
+                sendQueue.erase(order[i].second);
+            }
+
+            numQueuedSends = sendQueue.size();
+        }
+
+        if(!frameIds.empty())
+        {
+            sendBatch(frameIds);
+        }
+
+        return frameIds.size();
+    }
+
+
+    size_t SerialProcessor::queuedSends(void)
+    {
+        return numQueuedSends;
+    }
+
+
+    void SerialProcessor::setOutputBudget(size_t maxBacklogBytes)
+    {
+        std::lock_guard<std::mutex> guard(sendQueueLock);
+        outputBudgetBytes = maxBacklogBytes;
+    }
+
+
+    void SerialProcessor::setOutputLatencyBudget(double seconds)
+    {
+        std::lock_guard<std::mutex> guard(sendQueueLock);
+        outputBudgetSeconds = seconds;
+    }
+
+
+    size_t SerialProcessor::encodeFrameForSend(const SerialFrameId& frameId, const SerialValuesMap& values, map<SerialFrameId, DeltaEncodingState>& nextStates, char *dst, size_t dstLen, bool& delta)
+    {
+        delta = false;
+        auto deltaIt = deltaStates.find(frameId);
+        if(deltaIt != deltaStates.end())
+        {
+            //a frame sent earlier in the same write goes from the state that write leaves behind
+            auto nextIt = nextStates.find(frameId);
+            DeltaEncodingState state = (nextIt != nextStates.end() ? nextIt->second : deltaIt->second);
+            size_t len = encodeDeltaFrame(frameId, values, state, dst, dstLen, delta);
+            nextStates[frameId] = state;
+            return len;
+        }
+
+        return encodeFrame(frameId, values, dst, dstLen);
+    }
+
+
+    size_t SerialProcessor::encodeFrame(const SerialFrameId& frameId, const SerialValuesMap& values, char *dst, size_t dstLen)
+    {
+        if(frameMap.find(frameId) == frameMap.end())
+        {
+            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION(debugName + "Cannot send message with unknown frame id " + to_string(frameId));
+        }
+
+        const SerialFrame& frame = frameMap.at(frameId);
+        SERIAL_LIB_ASSERT(frame.size() <= dstLen, "Frame does not fit in the transmission buffer");
+        memset(dst, 0, frame.size());
+
+        //loop through minimal set of frames and pack each frame into the transmission buffer
+        set<SerialFieldId> frameSet(frame.begin(), frame.end());
+        for(auto fieldIt = frameSet.begin(); fieldIt != frameSet.end(); fieldIt++)
+        {
+            if(*fieldIt == FIELD_CHECKSUM)
+            {
+                continue;
+            }
+
+            SerialData dataToInsert = getFrameFieldData(frameId, *fieldIt, values);
+            insertFieldToBuffer(
+                dst, 
+                dstLen, 
+                frame, 
+                *fieldIt, 
+                dataToInsert.data,
+                dataToInsert.numData);
+        }
+
+        return frame.size();
+    }
+
+
+    size_t SerialProcessor::encodeDeltaFrame(const SerialFrameId& frameId, const SerialValuesMap& values, DeltaEncodingState& state, char *dst, size_t dstLen, bool& delta)
+    {
+        const SerialFrame& frame = frameMap.at(frameId);
+        vector<SerialFieldId> deltaFields = deltaFrameFields(frame);
+
+        //collect the current values of the fields in the frame
+        map<SerialFieldId, SerialData> current;
+        for(SerialFieldId field : deltaFields)
+        {
+            current[field] = getFrameFieldData(frameId, field, values);
+        }
+
+        bool keyframe = !state.primed || ++state.sendsSinceKeyframe >= state.keyframeInterval;
+        if(keyframe)
+        {
+            state.primed = true;
+            state.sendsSinceKeyframe = 0;
+            state.lastSent = current;
+            return encodeFrame(frameId, values, dst, dstLen);
+        }
+
+        size_t
+            headerLen = deltaFrameHeaderLength(frame),
+            bitmapLen = (deltaFields.size() + 7) / 8,
+            frameLen = headerLen + bitmapLen;
+        
+        SERIAL_LIB_ASSERT(frame.size() + bitmapLen <= dstLen, "Delta frame does not fit in the transmission buffer");
+        memset(dst, 0, headerLen + bitmapLen);
+
+        //header carries the sync and the flagged frame id in the same places as the full frame
+        SerialFrame header(frame.begin(), frame.begin() + headerLen);
+        char deltaFrameId = (char) (frameId | DELTA_FRAME_FLAG);
+        insertFieldToBuffer(dst, headerLen, header, FIELD_SYNC, syncValue, syncValueLen);
+        insertFieldToBuffer(dst, headerLen, header, FIELD_FRAME, &deltaFrameId, 1);
+
+        //bitmap followed by the changed fields
+        for(size_t i = 0; i < deltaFields.size(); i++)
+        {
+            const SerialData
+                &now = current[deltaFields[i]],
+                &last = state.lastSent[deltaFields[i]];
+            
+            if(now.numData == last.numData && memcmp(now.data, last.data, now.numData) == 0)
+            {
+                continue;
+            }
+
+            size_t fieldLen = countit(frame.begin(), frame.end(), deltaFields[i]);
+            dst[headerLen + i / 8] |= (1 << (i % 8));
+            memset(&dst[frameLen], 0, fieldLen);
+            memcpy(&dst[frameLen], now.data, (now.numData < fieldLen ? now.numData : fieldLen));
+            frameLen += fieldLen;
+            state.lastSent[deltaFields[i]] = now;
+        }
+
+        //room for the checksum, which goes in with insertChecksum()
+        if(findit(frame.begin(), frame.end(), FIELD_CHECKSUM) != frame.end())
+        {
+            memset(&dst[frameLen], 0, sizeof(Checksum));
+            frameLen += sizeof(Checksum);
+        }
+
+        delta = true;
+        return frameLen;
+    }
+
+
+    void SerialProcessor::insertChecksum(const EncodedFrame& encoded, char *dst)
+    {
+        const SerialFrame& frame = frameMap.at(encoded.frameId);
+        if(findit(frame.begin(), frame.end(), FIELD_CHECKSUM) == frame.end())
+        {
+            return;
+        }
+
+        if(encoded.delta)
+        {
+            //delta frames carry the checksum of everything before it at the end
+            Checksum checksum = callbacks.checksumGenerationFunc(dst, encoded.length - sizeof(Checksum));
+            convertToCString<Checksum>(checksum, &dst[encoded.length - sizeof(Checksum)], sizeof(Checksum));
+            return;
+        }
+
+        //remove the checksum bytes from the frame, compute the checksum over the rest, and put it in their place
+        memcpy(sendChecksumlessBuffer, dst, frame.size());
+        deleteChecksumFromBuffer(sendChecksumlessBuffer, frame.size(), frame);
+        Checksum checksum = callbacks.checksumGenerationFunc(sendChecksumlessBuffer, frame.size() - sizeof(Checksum));
+        size_t checksumLen = convertToCString<Checksum>(checksum, sendChecksumlessBuffer, sizeof(sendChecksumlessBuffer));
+        insertFieldToBuffer(
+            dst,
+            frame.size(),
+            frame,
+            FIELD_CHECKSUM,
+            sendChecksumlessBuffer,
+            checksumLen);
+    }
+
+
+    void SerialProcessor::checkSendable(const SerialFrameId& frameId, const SerialValuesMap& values) const
+    {
+        auto frameIt = frameMap.find(frameId);
+        if(frameIt == frameMap.end())
+        {
+            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION(debugName + "Cannot send message with unknown frame id " + to_string(frameId));
+        }
+
+        for(SerialFieldId field : frameIt->second)
+        {
+            if(field != FIELD_SYNC && field != FIELD_FRAME && field != FIELD_CHECKSUM && values.find(field) == values.end())
+            {
+                THROW_NON_FATAL_SERIAL_LIB_EXCEPTION(debugName + "Cannot send serial frame " + std::to_string(frameId) + " because it is missing field " + to_string(field));
+            }
+        }
+    }
+
+
+    SerialData SerialProcessor::getFrameFieldData(const SerialFrameId& frameId, SerialFieldId field, const SerialValuesMap& values)
+    {
+        SerialData data;
+        
+        //check if the field is a builtin type
+        if(field == FIELD_SYNC)
+        {
+            memcpy(data.data, syncValue, syncValueLen);
+            data.numData = syncValueLen;
+        } else if(field == FIELD_FRAME)
+        {
+            data.numData = convertToCString<SerialFrameId>(frameId, data.data, MAX_DATA_BYTES);
+        } else if(values.find(field) != values.end())
+        {
+            data = values.at(field).data;
+        } else
+        {
+            //if it is a custom type, throw exception because it is undefined
+            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION(debugName + "Cannot send serial frame " + std::to_string(frameId) + " because it is missing field " + to_string(field));
+        }
+
+        return data;
+    }
+
+
+    void SerialProcessor::setPacketMode(bool enabled)
+    {
+        if(enabled)
+        {
+            //on a byte stream, a frame split across reads would be dropped instead of waited for
+            SerialTransceiver::UniquePtr transceiver = transceiverResource.lockResource();
+            bool hasBoundaries = transceiver && (transceiver->capabilities() & TRANSCEIVER_CAP_MESSAGE_BOUNDARIES);
+            transceiverResource.unlockResource(std::move(transceiver));
+            SERIAL_LIB_ASSERT(hasBoundaries, "Packet mode needs a transceiver with TRANSCEIVER_CAP_MESSAGE_BOUNDARIES");
+        }
+
+        packetMode = enabled;
+        msgBufferCursorPos = 0;
+        arrivalMarks.clear();
+    }
+
+
+    void SerialProcessor::start(void)
+    {
+        //from the receive thread after it stopped itself, the loop it is in just carries on
+        if(loopThread == std::this_thread::get_id())
+        {
+            if(!receiving.exchange(true))
+            {
+                receiveGeneration = loopGeneration;
+            }
+
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(receiveControlLock);
+        if(receiving.exchange(true))
+        {
+            return;
+        }
+
+        //a thread that stopped itself may still be finishing an update. it sees that its run is over and ends
+        if(receiveThread.joinable())
+        {
+            receiveThread.join();
+        }
+
+        receiveThread = std::thread(&SerialProcessor::receiveLoop, this, ++receiveGeneration);
+    }
+
+
+    void SerialProcessor::stop(void)
+    {
+        //from the receive thread itself (a listener or a resumed coroutine) it cannot be joined. it ends once control
+        //gets back to its loop, and is joined by the next start() or stop() from another thread
+        if(loopThread == std::this_thread::get_id())
+        {
+            receiving = false;
+            receiveGeneration++;
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(receiveControlLock);
+        receiving = false;
+        receiveGeneration++;
+        if(receiveThread.joinable())
+        {
+            receiveThread.join();
+        }
+    }
+
+
+    bool SerialProcessor::running(void) const
+    {
+        return receiving;
+    }
+
+
+    bool SerialProcessor::waitForField(SerialFieldId field, double timeoutSeconds)
+    {
+        return waitForDecode([this, field] () {
+            auto it = fieldDecodes.find(field);
+            return (it == fieldDecodes.end() ? 0 : it->second);
+        }, timeoutSeconds);
+    }
+
+
+    bool SerialProcessor::waitForFrame(const SerialFrameId& frameId, double timeoutSeconds)
+    {
+        return waitForDecode([this, frameId] () {
+            auto it = frameDecodes.find(frameId);
+            return (it == frameDecodes.end() ? 0 : it->second);
+        }, timeoutSeconds);
+    }
+
+
+    bool SerialProcessor::waitForAny(double timeoutSeconds)
+    {
+        return waitForDecode([this] () { return numDecoded; }, timeoutSeconds);
+    }
+
+
+    void SerialProcessor::receiveLoop(uint64_t generation)
+    {
+        loopGeneration = generation;
+        loopThread = std::this_thread::get_id();
+        while(receiveGeneration == generation)
+        {
+            std::unique_lock<std::mutex> waitGuard(transceiverWaitLock);
+            SerialTransceiver::UniquePtr transceiver = transceiverResource.lockResource();
+            SerialTransceiver *waitingOn = transceiver.get();
+            NativeHandle handle = (transceiver ? transceiver->nativeHandle() : INVALID_NATIVE_HANDLE);
+            transceiverResource.unlockResource(std::move(transceiver));
+
+            if(!waitingOn)
+            {
+                waitGuard.unlock();
+                std::this_thread::sleep_for(std::chrono::nanoseconds(RECEIVE_THREAD_WAIT_NS));
+                continue;
+            }
+
+            //wait without holding the transceiver, so that sends can go out in the meantime. a handle is polled
+            //directly, because waitForData() may also reconnect, which is only safe under the transceiver's lock.
+            //transceivers without one wait their own way, such as a UDP peer reading its server's socket
+            bool 
+                ready = false,
+                hungUp = false;
+            
+            #if defined(USE_LINUX)
+            if(handle != INVALID_NATIVE_HANDLE)
+            {
+                pollfd pfd;
+                pfd.fd = handle;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+
+                timespec to;
+                to.tv_sec = 0;
+                to.tv_nsec = RECEIVE_THREAD_WAIT_NS;
+                ready = ppoll(&pfd, 1, &to, nullptr) > 0;
+                hungUp = ready && (pfd.revents & (POLLHUP | POLLERR | POLLNVAL));
+            } else
+            #endif
+            {
+                ready = waitingOn->waitForData(RECEIVE_THREAD_WAIT_NS / 1e9);
+            }
+
+            waitGuard.unlock();
+            if(!ready)
+            {
+                //update() is not called without data, so requests time out from here
+                if(numPendingRequests > 0)
+                {
+                    expireRequests();
+                }
+
+                //and queued frames go out as the link drains
+                if(numQueuedSends > 0)
+                {
+                    flushSendQueue();
+                }
+
+                continue;
+            }
+
+            uint64_t before = bytesReceived;
+            update(curtime());
+
+            if(hungUp)
+            {
+                //the handle stays ready while the link is down. update() still drains what is left and lets the
+                //transceiver reconnect, but only at the wait rate instead of back to back
+                std::this_thread::sleep_for(std::chrono::nanoseconds(RECEIVE_THREAD_WAIT_NS));
+            } else if(handle == INVALID_NATIVE_HANDLE && bytesReceived == before)
+            {
+                //the transceiver could not wait and had nothing, so do not ask again right away
+                std::this_thread::sleep_for(std::chrono::nanoseconds(RECEIVE_THREAD_IDLE_NS));
+            }
+        }
+    }
+
+
+    void SerialProcessor::notifyDecoded(const SerialFrameId& frameId, const SerialValuesMap& msgValues)
+    {
+        {
+            std::lock_guard<std::mutex> guard(decodeLock);
+            numDecoded++;
+            frameDecodes[frameId]++;
+            for(auto it = msgValues.begin(); it != msgValues.end(); it++)
+            {
+                fieldDecodes[it->first]++;
+            }
+        }
+
+        decodeCondition.notify_all();
+    }
+
+
+    bool SerialProcessor::waitForDecode(const std::function<uint64_t(void)>& count, double timeoutSeconds)
+    {
+        //count is read under decodeLock
+        std::unique_lock<std::mutex> guard(decodeLock);
+        uint64_t countAtStart = count();
+        auto decoded = [&count, countAtStart] () { return count() != countAtStart; };
+        if(timeoutSeconds < 0)
+        {
+            decodeCondition.wait(guard, decoded);
+            return true;
+        }
+
+        return decodeCondition.wait_for(guard, std::chrono::duration<double>(timeoutSeconds), decoded);
+    }
+
+
+    std::future<SerialValuesMap> SerialProcessor::sendAsync(
+        const SerialFrameId& requestFrame,
+        const SerialFrameId& responseFrame,
+        double timeoutSeconds,
+        SerialFieldId correlationField)
+    {
+        std::future<SerialValuesMap> response;
+        sendRequest(requestFrame, responseFrame, timeoutSeconds, correlationField, response);
+        return response;
+    }
+
+
+    bool SerialProcessor::sendAndAwait(
+        const SerialFrameId& requestFrame,
+        const SerialFrameId& responseFrame,
+        double timeoutSeconds,
+        SerialFieldId correlationField)
+    {
+        std::future<SerialValuesMap> response;
+        uint64_t id = sendRequest(requestFrame, responseFrame, -1, correlationField, response);
+        if(timeoutSeconds < 0)
+        {
+            response.wait();
+            return true;
+        }
+
+        if(response.wait_for(std::chrono::duration<double>(timeoutSeconds)) == std::future_status::ready)
+        {
+            return true;
+        }
+
+        //the response may still have come in between the wait and the cancel. if not, cancelling broke the promise
+        cancelRequest(id);
+        try
+        {
+            response.get();
+            return true;
+        } catch(const std::future_error&)
+        {
+            return false;
+        }
+    }
+
+
+    uint64_t SerialProcessor::sendRequest(
+        const SerialFrameId& requestFrame,
+        const SerialFrameId& responseFrame,
+        double timeoutSeconds,
+        SerialFieldId correlationField,
+        std::future<SerialValuesMap>& response)
+    {
+        PendingRequest request;
+        request.responseFrame = responseFrame;
+        request.correlationField = correlationField;
+        request.expires = (timeoutSeconds >= 0);
+        request.deadline = curtime() + std::chrono::duration_cast<Time::duration>(std::chrono::duration<double>(timeoutSeconds));
+        if(correlationField != FIELD_NONE)
+        {
+            //the value the request goes out with, as stored (before any endianness switch)
+            std::unique_ptr<SerialValuesMap> values = valueMapResource.lockResource();
+            auto it = values->find(correlationField);
+            request.correlationValue = (it != values->end() ? it->second.data : SerialData());
+            valueMapResource.unlockResource(std::move(values));
+        }
+
+        //register before sending, so a quick response cannot slip past
+        response = request.response.get_future();
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> guard(requestLock);
+            id = request.id = nextRequestId++;
+            pendingRequests.push_back(std::move(request));
+            numPendingRequests = pendingRequests.size();
+        }
+
+        try
+        {
+            send(requestFrame);
+        } catch(...)
+        {
+            cancelRequest(id);
+            throw;
+        }
+
+        return id;
+    }
+
+
+    void SerialProcessor::cancelRequest(uint64_t id)
+    {
+        std::lock_guard<std::mutex> guard(requestLock);
+        pendingRequests.remove_if([id] (const PendingRequest& request) { return request.id == id; });
+        numPendingRequests = pendingRequests.size();
+    }
+
+
+    void SerialProcessor::completeRequests(const SerialFrameId& frameId, const SerialValuesMap& msgValues)
+    {
+        std::lock_guard<std::mutex> guard(requestLock);
+        for(auto it = pendingRequests.begin(); it != pendingRequests.end(); it++)
+        {
+            if(it->responseFrame != frameId)
+            {
+                continue;
+            }
+
+            if(it->correlationField != FIELD_NONE)
+            {
+                auto value = msgValues.find(it->correlationField);
+                if(value == msgValues.end() || 
+                    value->second.data.numData != it->correlationValue.numData ||
+                    memcmp(value->second.data.data, it->correlationValue.data, it->correlationValue.numData) != 0)
+                {
+                    continue;
+                }
+            }
+
+            //one response answers one request, the oldest one it matches
+            it->response.set_value(userValues(msgValues));
+            pendingRequests.erase(it);
+            break;
+        }
+
+        numPendingRequests = pendingRequests.size();
+    }
+
+
+    void SerialProcessor::expireRequests(void)
+    {
+        Time now = curtime();
+        std::lock_guard<std::mutex> guard(requestLock);
+        for(auto it = pendingRequests.begin(); it != pendingRequests.end();)
+        {
+            if(!it->expires || now < it->deadline)
+            {
+                it++;
+                continue;
+            }
+
+            SERLIB_LOG_DEBUG("%s: Request waiting for frame %d timed out", debugName.c_str(), it->responseFrame);
+            it->response.set_exception(std::make_exception_ptr(NonFatalSerialLibraryException(
+                debugName + ": timed out waiting for response frame " + to_string(it->responseFrame))));
+            
+            it = pendingRequests.erase(it);
+        }
+
+        numPendingRequests = pendingRequests.size();
+    }
+
+
+    uint64_t SerialProcessor::addFrameListener(const SerialFrameId& frameId, const FrameListener& listener)
+    {
+        std::lock_guard<std::mutex> guard(listenerLock);
+        uint64_t id = nextListenerId++;
+        frameListeners.insert({ id, { frameId, listener } });
+        numFrameListeners = frameListeners.size();
+        return id;
+    }
+
+
+    void SerialProcessor::removeFrameListener(uint64_t id)
+    {
+        std::unique_lock<std::mutex> guard(listenerLock);
+        frameListeners.erase(id);
+        numFrameListeners = frameListeners.size();
+
+        //a call on this thread is the caller itself (or something it ran), which cannot be waited for
+        std::thread::id self = std::this_thread::get_id();
+        listenerCondition.wait(guard, [this, id, self] () {
+            auto it = listenerCalls.find(id);
+            return it == listenerCalls.end() || (size_t) countit(it->second.begin(), it->second.end(), self) == it->second.size();
+        });
+    }
+
+
+    void SerialProcessor::callFrameListeners(const SerialFrameId& frameId, const SerialValuesMap& msgValues)
+    {
+        //listeners run unlocked so they can add and remove listeners, so one may be gone by the time its turn comes
+        vector<pair<uint64_t, FrameListener>> toCall;
+        {
+            std::lock_guard<std::mutex> guard(listenerLock);
+            for(auto it = frameListeners.begin(); it != frameListeners.end(); it++)
+            {
+                if(it->second.first == frameId)
+                {
+                    toCall.push_back({ it->first, it->second.second });
+                }
+            }
+        }
+
+        SerialValuesMap values = userValues(msgValues);
+        std::thread::id self = std::this_thread::get_id();
+        for(const pair<uint64_t, FrameListener>& listener : toCall)
+        {
+            //registered as running under the same lock as the check, so removeFrameListener() waits for the call
+            {
+                std::lock_guard<std::mutex> guard(listenerLock);
+                if(frameListeners.find(listener.first) == frameListeners.end())
+                {
+                    continue;
+                }
+
+                listenerCalls[listener.first].push_back(self);
+            }
+
+            bool done;
+            try
+            {
+                done = listener.second(values);
+            } catch(...)
+            {
+                finishListenerCall(listener.first);
+                throw;
+            }
+
+            finishListenerCall(listener.first);
+            if(done)
+            {
+                removeFrameListener(listener.first);
+            }
+        }
+    }
+
+
+    void SerialProcessor::finishListenerCall(uint64_t id)
+    {
+        {
+            std::lock_guard<std::mutex> guard(listenerLock);
+            vector<std::thread::id>& callers = listenerCalls[id];
+            callers.erase(findit(callers.begin(), callers.end(), std::this_thread::get_id()));
+            if(callers.empty())
+            {
+                listenerCalls.erase(id);
+            }
+        }
+
+        listenerCondition.notify_all();
+    }
+
+
+    SerialValuesMap SerialProcessor::userValues(const SerialValuesMap& msgValues) const
+    {
+        //what getField() would return for each value
+        SerialValuesMap values = msgValues;
+        if(switchEndianness)
+        {
+            for(auto it = values.begin(); it != values.end(); it++)
+            {
+                it->second = switchStampedDataEndianness(it->second);
+            }
+        }
+
+        return values;
+    }
+
+
+    void SerialProcessor::setDeltaEncoding(const SerialFrameId& frameId, unsigned int keyframeInterval)
+    {
+        std::lock_guard<std::mutex> sendGuard(sendLock);
+        std::lock_guard<std::mutex> deltaGuard(deltaFramesLock);
+        if(keyframeInterval == 0)
+        {
+            deltaStates.erase(frameId);
+            deltaFrames.erase(frameId);
+            return;
+        }
+
+        SERIAL_LIB_ASSERT(frameMap.find(frameId) != frameMap.end(), "Cannot delta-encode an unknown frame");
+        SERIAL_LIB_ASSERT((frameId & DELTA_FRAME_FLAG) == 0, "Delta-encoded frames must have ids below DELTA_FRAME_FLAG");
+        SERIAL_LIB_ASSERT(frameMap.find(frameId | DELTA_FRAME_FLAG) == frameMap.end(), "Frame id with DELTA_FRAME_FLAG set is already in use");
+        
+        const SerialFrame& frame = frameMap.at(frameId);
+        SERIAL_LIB_ASSERT(findit(frame.begin(), frame.end(), FIELD_FRAME) != frame.end(), "Delta-encoded frames must contain a frame field");
+
+        DeltaEncodingState state;
+        state.keyframeInterval = keyframeInterval;
+        state.sendsSinceKeyframe = 0;
+        state.primed = false;
+        deltaStates[frameId] = state;
+        deltaFrames.insert(frameId);
+    }
+
+
+    bool SerialProcessor::decodesDelta(const SerialFrameId& frameId)
+    {
+        std::lock_guard<std::mutex> guard(deltaFramesLock);
+        return deltaFrames.find(frameId) != deltaFrames.end();
     }
 
     unsigned short SerialProcessor::failedOfLastTenMessages()
@@ -0,0 +1,262 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <cmath>
+
+// epoll reactor for SerialProcessors: https://man7.org/linux/man-pages/man7/epoll.7.html
+
+#define REACTOR_MAX_EVENTS 64
+#define REACTOR_WAKE_KEY 0
+
+namespace serial_library
+{
+    SerialReactor::SerialReactor()
+    : _stopRequested(false),
+      _nextKey(REACTOR_WAKE_KEY + 1)
+    {
+        _epoll = epoll_create1(EPOLL_CLOEXEC);
+        if(_epoll < 0)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("epoll_create1() failed: " + string(strerror(errno)));
+        }
+
+        _wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(_wakeEvent < 0)
+        {
+            close(_epoll);
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("eventfd() failed: " + string(strerror(errno)));
+        }
+
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = REACTOR_WAKE_KEY;
+        if(epoll_ctl(_epoll, EPOLL_CTL_ADD, _wakeEvent, &ev) < 0)
+        {
+            close(_wakeEvent);
+            close(_epoll);
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("epoll_ctl() failed to add wake event: " + string(strerror(errno)));
+        }
+    }
+
+
+    SerialReactor::~SerialReactor()
+    {
+        for(auto it = _registrations.begin(); it != _registrations.end(); it++)
+        {
+            if(!it->second.processor)
+            {
+                //timers own their fd
+                close(it->second.fd);
+            }
+        }
+
+        close(_wakeEvent);
+        close(_epoll);
+    }
+
+
+    void SerialReactor::addProcessor(const SerialProcessor::SharedPtr& processor)
+    {
+        NativeHandle handle = processor->nativeHandle();
+        if(handle == INVALID_NATIVE_HANDLE)
+        {
+            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION("Cannot add processor to reactor because its transceiver has no native handle");
+        }
+
+        Registration registration;
+        registration.fd = handle;
+        registration.processor = processor;
+        addRegistration(handle, registration);
+    }
+
+
+    void SerialReactor::removeProcessor(const SerialProcessor::SharedPtr& processor)
+    {
+        uint64_t key = REACTOR_WAKE_KEY;
+        _registrationsLock.lock();
+        for(auto it = _registrations.begin(); it != _registrations.end(); it++)
+        {
+            if(it->second.processor == processor)
+            {
+                key = it->first;
+                break;
+            }
+        }
+
+        _registrationsLock.unlock();
+
+        if(key != REACTOR_WAKE_KEY)
+        {
+            removeRegistration(key);
+        }
+    }
+
+
+    SerialReactor::TimerId SerialReactor::addTimer(double periodSeconds, const TimerCallback& callback)
+    {
+        SERIAL_LIB_ASSERT(periodSeconds > 0, "Timer period must be positive");
+
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if(fd < 0)
+        {
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("timerfd_create() failed: " + string(strerror(errno)));
+        }
+
+        itimerspec spec;
+        spec.it_interval.tv_sec = (time_t) periodSeconds;
+        spec.it_interval.tv_nsec = (long) ((periodSeconds - (double) spec.it_interval.tv_sec) * 1000000000);
+        spec.it_value = spec.it_interval;
+        if(timerfd_settime(fd, 0, &spec, nullptr) < 0)
+        {
+            close(fd);
+            THROW_FATAL_SERIAL_LIB_EXCEPTION("timerfd_settime() failed: " + string(strerror(errno)));
+        }
+
+        Registration registration;
+        registration.fd = fd;
+        registration.timerCallback = callback;
+        return (TimerId) addRegistration(fd, registration);
+    }
+
+
+    void SerialReactor::removeTimer(TimerId timer)
+    {
+        removeRegistration((uint64_t) timer);
+    }
+
+
+    size_t SerialReactor::spinOnce(double timeoutSeconds)
+    {
+        epoll_event events[REACTOR_MAX_EVENTS];
+        //rounded up so that sub-millisecond timeouts still wait instead of busy-polling
+        int timeoutMs = (timeoutSeconds < 0 ? -1 : (int) std::ceil(timeoutSeconds * 1000));
+        int numEvents = epoll_wait(_epoll, events, REACTOR_MAX_EVENTS, timeoutMs);
+        if(numEvents < 0)
+        {
+            if(errno != EINTR)
+            {
+                SERLIB_LOG_ERROR("epoll_wait() failed: %s", strerror(errno));
+            }
+
+            return 0;
+        }
+
+        //one timestamp per wake, every event in it happened "now"
+        Time now = curtime();
+        size_t handled = 0;
+        for(int i = 0; i < numEvents; i++)
+        {
+            uint64_t key = events[i].data.u64;
+            if(key == REACTOR_WAKE_KEY)
+            {
+                eventfd_t count;
+                eventfd_read(_wakeEvent, &count);
+                continue;
+            }
+
+            //copy the registration so that callbacks can add or remove registrations
+            _registrationsLock.lock();
+            auto it = _registrations.find(key);
+            if(it == _registrations.end())
+            {
+                //removed by an earlier callback in this wake
+                _registrationsLock.unlock();
+                continue;
+            }
+
+            Registration registration = it->second;
+            _registrationsLock.unlock();
+
+            if(registration.processor)
+            {
+                //level-triggered, so a link with more data pending is reported again on the next wake
+                registration.processor->update(now);
+            } else
+            {
+                uint64_t expirations;
+                if(read(registration.fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+                {
+                    registration.timerCallback(now);
+                }
+            }
+
+            handled++;
+        }
+
+        return handled;
+    }
+
+
+    void SerialReactor::spin()
+    {
+        //the request is consumed on the way out rather than cleared on the way in, so a stop() that comes before
+        //spin() is not lost
+        while(!_stopRequested.exchange(false))
+        {
+            spinOnce(-1);
+        }
+    }
+
+
+    void SerialReactor::stop()
+    {
+        _stopRequested = true;
+        eventfd_write(_wakeEvent, 1);
+    }
+
+
+    uint64_t SerialReactor::addRegistration(int fd, const Registration& registration)
+    {
+        _registrationsLock.lock();
+        uint64_t key = _nextKey++;
+        _registrations[key] = registration;
+        _registrationsLock.unlock();
+
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = key;
+        if(epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            _registrationsLock.lock();
+            _registrations.erase(key);
+            _registrationsLock.unlock();
+            THROW_NON_FATAL_SERIAL_LIB_EXCEPTION("epoll_ctl() failed to add fd " + to_string(fd) + ": " + string(strerror(errno)));
+        }
+
+        return key;
+    }
+
+
+    void SerialReactor::removeRegistration(uint64_t key)
+    {
+        _registrationsLock.lock();
+        auto it = _registrations.find(key);
+        if(it == _registrations.end())
+        {
+            _registrationsLock.unlock();
+            return;
+        }
+
+        Registration registration = it->second;
+        _registrations.erase(it);
+        _registrationsLock.unlock();
+
+        if(epoll_ctl(_epoll, EPOLL_CTL_DEL, registration.fd, nullptr) < 0)
+        {
+            SERLIB_LOG_ERROR("epoll_ctl() failed to remove fd %d: %s", registration.fd, strerror(errno));
+        }
+
+        if(!registration.processor)
+        {
+            close(registration.fd);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,330 @@
+#include "serial_library/serial_library.hpp"
+#include <cmath>
+
+// timer wheel layout, as in the classic Linux kernel timer wheel: 256 one-tick slots, then levels of 64 slots that
+// each cover a whole lap of the level below. Entries move down a level whenever the level below wraps around
+#define WHEEL_LEVEL0_BITS 8
+#define WHEEL_LEVEL_BITS 6
+#define WHEEL_LEVELS 4
+#define WHEEL_LEVEL0_SLOTS (1 << WHEEL_LEVEL0_BITS)
+#define WHEEL_LEVEL_SLOTS (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_SPAN_TICKS (1LL << (WHEEL_LEVEL0_BITS + (WHEEL_LEVELS - 1) * WHEEL_LEVEL_BITS))
+
+// how long spin() sleeps when nothing is scheduled. add() wakes it early
+#define SCHEDULER_IDLE_WAIT_SECONDS 1
+
+namespace serial_library
+{
+    static size_t wheelSlot(int level, int64_t tick)
+    {
+        if(level == 0)
+        {
+            return tick & (WHEEL_LEVEL0_SLOTS - 1);
+        }
+
+        int shift = WHEEL_LEVEL0_BITS + (level - 1) * WHEEL_LEVEL_BITS;
+        return WHEEL_LEVEL0_SLOTS + (level - 1) * WHEEL_LEVEL_SLOTS + ((tick >> shift) & (WHEEL_LEVEL_SLOTS - 1));
+    }
+
+
+    void SerialScheduler::Accumulator::add(double lateness, uint64_t missed)
+    {
+        //running mean and variance (Welford)
+        stats.sends++;
+        stats.missedDeadlines += missed;
+        double delta = lateness - stats.meanLatenessSeconds;
+        stats.meanLatenessSeconds += delta / stats.sends;
+        sumSquares += delta * (lateness - stats.meanLatenessSeconds);
+        stats.jitterSeconds = std::sqrt(sumSquares / stats.sends);
+        stats.maxLatenessSeconds = std::max(stats.maxLatenessSeconds, lateness);
+    }
+
+
+    SerialScheduler::SerialScheduler(double tickSeconds)
+     : _origin(curtime()),
+       _tickNs((int64_t) (tickSeconds * 1000000000)),
+       _currentTick(0),
+       _nextId(0),
+       _slots(WHEEL_LEVEL0_SLOTS + (WHEEL_LEVELS - 1) * WHEEL_LEVEL_SLOTS),
+       _stopRequested(false)
+    {
+        SERIAL_LIB_ASSERT(_tickNs > 0, "Scheduler tick must be positive");
+    }
+
+
+    SerialScheduler::~SerialScheduler()
+    {
+        stop();
+    }
+
+
+    SerialScheduler::EntryId SerialScheduler::add(
+        const SerialProcessor::SharedPtr& processor,
+        const SerialFrameId& frameId,
+        double periodSeconds,
+        double phaseSeconds,
+        int priority)
+    {
+        SERIAL_LIB_ASSERT(periodSeconds > 0, "Scheduled period must be positive");
+
+        Entry entry;
+        entry.processor = processor;
+        entry.frameId = frameId;
+        entry.periodNs = (int64_t) (periodSeconds * 1000000000);
+        entry.priority = priority;
+
+        //first deadline on the shared grid that has not passed yet
+        int64_t 
+            phaseNs = (int64_t) (phaseSeconds * 1000000000) % entry.periodNs,
+            nowNs = nanosecondsSinceOrigin(curtime());
+        
+        entry.deadlineNs = phaseNs;
+        if(nowNs > phaseNs)
+        {
+            entry.deadlineNs += ((nowNs - phaseNs) / entry.periodNs + 1) * entry.periodNs;
+        }
+
+        std::lock_guard<std::mutex> guard(_lock);
+        EntryId id = _nextId++;
+        _entries.insert({ id, entry });
+        insert(id, dueTick(entry.deadlineNs));
+        _wake.notify_all();
+        return id;
+    }
+
+
+    void SerialScheduler::remove(EntryId id)
+    {
+        //its slot keeps the id until the slot comes up, and drops it then
+        std::lock_guard<std::mutex> guard(_lock);
+        _entries.erase(id);
+    }
+
+
+    size_t SerialScheduler::runDue(const Time& now)
+    {
+        //batches are built under the lock and sent after it is released, so a slow write does not hold up add(),
+        //stats() or stop(), and a transceiver can call back into the scheduler
+        std::unique_lock<std::mutex> guard(_lock);
+        int64_t 
+            nowNs = nanosecondsSinceOrigin(now),
+            nowTick = nowNs / _tickNs;
+        
+        if(nowNs < 0)
+        {
+            return 0;
+        }
+
+        //collect every tick that has started
+        vector<EntryId> due;
+        while(_currentTick <= nowTick)
+        {
+            if(_entries.empty())
+            {
+                _currentTick = nowTick + 1;
+                break;
+            }
+
+            if(wheelSlot(0, _currentTick) == 0)
+            {
+                cascade(_currentTick);
+            }
+
+            vector<EntryId>& slot = _slots[wheelSlot(0, _currentTick)];
+            due.insert(due.end(), slot.begin(), slot.end());
+            slot.clear();
+            _currentTick++;
+        }
+
+        //one batch per processor, highest priority first
+        vector<pair<int, EntryId>> order;
+        for(EntryId id : due)
+        {
+            auto it = _entries.find(id);
+            if(it != _entries.end())
+            {
+                order.push_back({ -it->second.priority, id });
+            }
+        }
+
+        std::stable_sort(order.begin(), order.end(), [] (const pair<int, EntryId>& a, const pair<int, EntryId>& b) { return a.first < b.first; });
+
+        //shared pointers, so that entries removed while sending keep their processors alive
+        vector<pair<SerialProcessor::SharedPtr, vector<SerialFrameId>>> batches;
+        for(const pair<int, EntryId>& item : order)
+        {
+            Entry& entry = _entries.at(item.second);
+            auto batch = std::find_if(batches.begin(), batches.end(), [&entry] (const pair<SerialProcessor::SharedPtr, vector<SerialFrameId>>& b) { return b.first == entry.processor; });
+            if(batch == batches.end())
+            {
+                batches.push_back({ entry.processor, {} });
+                batch = batches.end() - 1;
+            }
+
+            batch->second.push_back(entry.frameId);
+
+            //late sends still go out once. whole periods that passed meanwhile are skipped and counted as missed
+            int64_t latenessNs = nowNs - entry.deadlineNs;
+            uint64_t missed = (uint64_t) (latenessNs / entry.periodNs);
+            entry.accumulator.add(latenessNs / 1e9, missed);
+            _total.add(latenessNs / 1e9, missed);
+            entry.deadlineNs += (missed + 1) * entry.periodNs;
+            insert(item.second, dueTick(entry.deadlineNs));
+        }
+
+        guard.unlock();
+
+        size_t sent = 0;
+        for(const pair<SerialProcessor::SharedPtr, vector<SerialFrameId>>& batch : batches)
+        {
+            try
+            {
+                batch.first->sendBatch(batch.second);
+                sent += batch.second.size();
+            } catch(const SerialLibraryException& ex)
+            {
+                SERLIB_LOG_ERROR("Scheduled send failed: %s", ex.what());
+            }
+        }
+
+        return sent;
+    }
+
+
+    Time SerialScheduler::nextWake(void)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if(_entries.empty())
+        {
+            return curtime() + std::chrono::seconds(SCHEDULER_IDLE_WAIT_SECONDS);
+        }
+
+        //the first occupied slot of this lap of level 0, or the end of the lap, where the next level cascades down
+        int64_t tick = _currentTick;
+        do
+        {
+            if(!_slots[wheelSlot(0, tick)].empty())
+            {
+                break;
+            }
+
+            tick++;
+        } while(wheelSlot(0, tick) != 0);
+
+        return _origin + std::chrono::duration_cast<Time::duration>(std::chrono::nanoseconds(tick * _tickNs));
+    }
+
+
+    void SerialScheduler::spin(void)
+    {
+        while(true)
+        {
+            Time wake = nextWake();
+            {
+                //the request is consumed on the way out rather than cleared on the way in, so a stop() that comes
+                //before spin() is not lost
+                std::unique_lock<std::mutex> guard(_lock);
+                if(!_stopRequested)
+                {
+                    //add() and stop() wake this early
+                    _wake.wait_until(guard, wake);
+                }
+
+                if(_stopRequested)
+                {
+                    _stopRequested = false;
+                    break;
+                }
+            }
+
+            runDue(curtime());
+        }
+    }
+
+
+    void SerialScheduler::stop(void)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopRequested = true;
+        _wake.notify_all();
+    }
+
+
+    SchedulerStats SerialScheduler::stats(EntryId id)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        auto it = _entries.find(id);
+        return (it != _entries.end() ? it->second.accumulator.stats : SchedulerStats());
+    }
+
+
+    SchedulerStats SerialScheduler::stats(void)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _total.stats;
+    }
+
+
+    Time SerialScheduler::origin(void) const
+    {
+        return _origin;
+    }
+
+
+    void SerialScheduler::insert(EntryId id, int64_t dueTick)
+    {
+        //deadlines that already passed go in the next slot to run
+        int64_t delta = std::max(dueTick, _currentTick) - _currentTick;
+        if(delta >= WHEEL_SPAN_TICKS)
+        {
+            //past the top level. parked in its last slot, and placed properly when it cascades from there
+            delta = WHEEL_SPAN_TICKS - 1;
+        }
+
+        int64_t tick = _currentTick + delta;
+        int level = 0;
+        while(level < WHEEL_LEVELS - 1 && delta >= (1LL << (WHEEL_LEVEL0_BITS + level * WHEEL_LEVEL_BITS)))
+        {
+            level++;
+        }
+
+        _slots[wheelSlot(level, tick)].push_back(id);
+    }
+
+
+    void SerialScheduler::cascade(int64_t tick)
+    {
+        //level 0 just wrapped. each level's current slot moves down, and the next level goes too if this one wrapped
+        for(int level = 1; level < WHEEL_LEVELS; level++)
+        {
+            vector<EntryId> moving;
+            moving.swap(_slots[wheelSlot(level, tick)]);
+            for(EntryId id : moving)
+            {
+                auto it = _entries.find(id);
+                if(it != _entries.end())
+                {
+                    insert(id, dueTick(it->second.deadlineNs));
+                }
+            }
+
+            if(((tick >> (WHEEL_LEVEL0_BITS + (level - 1) * WHEEL_LEVEL_BITS)) & (WHEEL_LEVEL_SLOTS - 1)) != 0)
+            {
+                break;
+            }
+        }
+    }
+
+
+    int64_t SerialScheduler::dueTick(int64_t deadlineNs) const
+    {
+        //the first tick that starts at or after the deadline, so nothing fires early
+        return (deadlineNs + _tickNs - 1) / _tickNs;
+    }
+
+
+    int64_t SerialScheduler::nanosecondsSinceOrigin(const Time& time) const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - _origin).count();
+    }
+}
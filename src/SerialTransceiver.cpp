@@ -0,0 +1,149 @@
+#include "serial_library/serial_library.hpp"
+
+#if defined(USE_LINUX)
+#include <sys/ioctl.h>
+#endif
+
+//
+// Default implementations of the optional SerialTransceiver functions.
+// Transceivers that can do better override these.
+//
+
+namespace serial_library
+{
+    void SerialTransceiver::sendv(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        size_t total = 0;
+        for(size_t i = 0; i < numVecs; i++)
+        {
+            total += vecs[i].numData;
+        }
+
+        //gather into one buffer so that the pieces still go out as one transmission
+        vector<char> gathered(total);
+        size_t cursor = 0;
+        for(size_t i = 0; i < numVecs; i++)
+        {
+            memcpy(&gathered[cursor], vecs[i].data, vecs[i].numData);
+            cursor += vecs[i].numData;
+        }
+
+        send(gathered.data(), gathered.size());
+    }
+
+
+    size_t SerialTransceiver::recvv(const SerialIoVec *vecs, size_t numVecs)
+    {
+        size_t total = 0;
+        for(size_t i = 0; i < numVecs; i++)
+        {
+            total += vecs[i].numData;
+        }
+
+        vector<char> received(total);
+        size_t 
+            recvd = recv(received.data(), received.size()),
+            cursor = 0;
+
+        //scatter received bytes across the pieces
+        for(size_t i = 0; i < numVecs && cursor < recvd; i++)
+        {
+            size_t n = (recvd - cursor < vecs[i].numData ? recvd - cursor : vecs[i].numData);
+            memcpy(vecs[i].data, &received[cursor], n);
+            cursor += n;
+        }
+
+        return recvd;
+    }
+
+
+    size_t SerialTransceiver::recvPackets(char *data, size_t numData, SerialPacketInfo *packets, size_t maxPackets)
+    {
+        if(maxPackets == 0)
+        {
+            return 0;
+        }
+
+        size_t recvd = recv(data, numData);
+        if(recvd == 0)
+        {
+            return 0;
+        }
+
+        packets[0].offset = 0;
+        packets[0].length = recvd;
+        return 1;
+    }
+
+
+    void SerialTransceiver::sendPackets(const SerialConstIoVec *packets, size_t numPackets)
+    {
+        for(size_t i = 0; i < numPackets; i++)
+        {
+            send(packets[i].data, packets[i].numData);
+        }
+    }
+
+
+    unsigned int SerialTransceiver::capabilities(void) const
+    {
+        return TRANSCEIVER_CAP_NONE;
+    }
+
+
+    NativeHandle SerialTransceiver::nativeHandle(void) const
+    {
+        return INVALID_NATIVE_HANDLE;
+    }
+
+
+    double SerialTransceiver::secondsPerByte(void) const
+    {
+        return 0;
+    }
+
+
+    size_t SerialTransceiver::outputBacklog(void) const
+    {
+        #if defined(USE_LINUX)
+        //SIOCOUTQ and TIOCOUTQ are the same request, so this covers ttys and sockets alike
+        int queued = 0;
+        NativeHandle handle = nativeHandle();
+        if(handle != INVALID_NATIVE_HANDLE && ioctl(handle, TIOCOUTQ, &queued) == 0 && queued > 0)
+        {
+            return queued;
+        }
+        #endif
+
+        return 0;
+    }
+
+
+    bool SerialTransceiver::waitForData(double timeoutSeconds)
+    {
+        #if defined(USE_LINUX)
+        NativeHandle handle = nativeHandle();
+        if(handle != INVALID_NATIVE_HANDLE)
+        {
+            pollfd pfd;
+            pfd.fd = handle;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+
+            //negative timeout waits forever
+            timespec to;
+            to.tv_sec = (time_t) timeoutSeconds;
+            to.tv_nsec = (long) ((timeoutSeconds - (double) to.tv_sec) * 1000000000);
+            int ret = ppoll(&pfd, 1, (timeoutSeconds < 0 ? nullptr : &to), nullptr);
+            if(ret < 0 && errno != EINTR)
+            {
+                SERLIB_LOG_ERROR("ppoll() failed: %s", strerror(errno));
+            }
+
+            return ret > 0;
+        }
+        #endif
+
+        return true;
+    }
+}
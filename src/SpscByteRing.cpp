@@ -0,0 +1,294 @@
+#include "serial_library/serial_library.hpp"
+#include <thread>
+
+#if defined(USE_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define SPSC_RING_MAGIC 0x53505343
+
+namespace serial_library
+{
+    static uint64_t roundUpToPowerOfTwo(uint64_t value)
+    {
+        uint64_t result = 1;
+        while(result < value)
+        {
+            result <<= 1;
+        }
+
+        return result;
+    }
+
+
+    SpscByteRing::SpscByteRing()
+    : _header(nullptr),
+      _data(nullptr),
+      _mask(0)
+    { }
+
+
+    size_t SpscByteRing::regionSize(size_t capacity)
+    {
+        //at least a cache line of data, so that a ring placed right after this one stays aligned
+        return sizeof(Header) + std::max(roundUpToPowerOfTwo(capacity), (uint64_t) alignof(Header));
+    }
+
+
+    bool SpscByteRing::attach(void *region, size_t regionLen, bool initialize, size_t capacity)
+    {
+        if(((uintptr_t) region % alignof(Header)) != 0 || regionLen < sizeof(Header))
+        {
+            SERLIB_LOG_ERROR("Ring region is misaligned or too small");
+            return false;
+        }
+
+        Header *header;
+        if(initialize)
+        {
+            capacity = roundUpToPowerOfTwo(capacity);
+            if(capacity == 0 || regionLen < sizeof(Header) + capacity)
+            {
+                SERLIB_LOG_ERROR("Ring region of %d bytes cannot hold %d bytes of data", (int) regionLen, (int) capacity);
+                return false;
+            }
+
+            header = new (region) Header();
+            header->capacity = capacity;
+            header->writeIndex = 0;
+            header->readIndex = 0;
+            header->dataSignal = 0;
+            header->readerWaiting = 0;
+            header->spaceSignal = 0;
+            header->writerWaiting = 0;
+            header->magic = SPSC_RING_MAGIC;
+        } else
+        {
+            header = reinterpret_cast<Header *>(region);
+            if(header->magic != SPSC_RING_MAGIC || regionLen < sizeof(Header) + header->capacity)
+            {
+                SERLIB_LOG_ERROR("Region does not hold an initialized ring");
+                return false;
+            }
+        }
+
+        _header = header;
+        _data = reinterpret_cast<char *>(region) + sizeof(Header);
+        _mask = header->capacity - 1;
+        return true;
+    }
+
+
+    bool SpscByteRing::attached(void) const
+    {
+        return _header != nullptr;
+    }
+
+
+    bool SpscByteRing::write(const char *data, size_t numData)
+    {
+        SerialConstIoVec vec = { data, numData };
+        return writev(&vec, 1);
+    }
+
+
+    bool SpscByteRing::writev(const SerialConstIoVec *vecs, size_t numVecs)
+    {
+        size_t total = 0;
+        for(size_t i = 0; i < numVecs; i++)
+        {
+            total += vecs[i].numData;
+        }
+
+        if(!attached() || total > writable())
+        {
+            return false;
+        }
+
+        uint64_t index = _header->writeIndex.load(std::memory_order_relaxed);
+        for(size_t i = 0; i < numVecs; i++)
+        {
+            copyIn(index, vecs[i].data, vecs[i].numData);
+            index += vecs[i].numData;
+        }
+
+        //publish the bytes, then wake the reader if it is asleep
+        _header->writeIndex.store(index, std::memory_order_release);
+        notify(_header->dataSignal, _header->readerWaiting);
+        return true;
+    }
+
+
+    size_t SpscByteRing::read(char *data, size_t numData)
+    {
+        if(!attached())
+        {
+            return 0;
+        }
+
+        size_t n;
+        uint64_t index = _header->readIndex.load(std::memory_order_acquire);
+        do
+        {
+            n = std::min((size_t) (_header->writeIndex.load(std::memory_order_acquire) - index), numData);
+            if(n == 0)
+            {
+                return 0;
+            }
+
+            copyOut(index, data, n);
+
+            //if the writer discarded these bytes while they were copied, they may be torn, so copy again
+        } while(!_header->readIndex.compare_exchange_weak(index, index + n, std::memory_order_acq_rel));
+
+        notify(_header->spaceSignal, _header->writerWaiting);
+        return n;
+    }
+
+
+    size_t SpscByteRing::discardOldest(size_t numData)
+    {
+        if(!attached())
+        {
+            return 0;
+        }
+
+        size_t n;
+        uint64_t index = _header->readIndex.load(std::memory_order_acquire);
+        do
+        {
+            n = std::min((size_t) (_header->writeIndex.load(std::memory_order_relaxed) - index), numData);
+        } while(n > 0 && !_header->readIndex.compare_exchange_weak(index, index + n, std::memory_order_acq_rel));
+
+        return n;
+    }
+
+
+    size_t SpscByteRing::readable(void) const
+    {
+        if(!attached())
+        {
+            return 0;
+        }
+
+        return _header->writeIndex.load(std::memory_order_acquire) - _header->readIndex.load(std::memory_order_acquire);
+    }
+
+
+    size_t SpscByteRing::writable(void) const
+    {
+        return capacity() - readable();
+    }
+
+
+    size_t SpscByteRing::capacity(void) const
+    {
+        return (attached() ? _header->capacity : 0);
+    }
+
+
+    bool SpscByteRing::waitReadable(double timeoutSeconds, bool spin)
+    {
+        if(!attached())
+        {
+            return false;
+        }
+
+        return wait(_header->dataSignal, _header->readerWaiting, [this] () { return readable() > 0; }, timeoutSeconds, spin);
+    }
+
+
+    bool SpscByteRing::waitWritable(size_t numData, double timeoutSeconds, bool spin)
+    {
+        if(!attached() || numData > capacity())
+        {
+            return false;
+        }
+
+        return wait(_header->spaceSignal, _header->writerWaiting, [this, numData] () { return writable() >= numData; }, timeoutSeconds, spin);
+    }
+
+
+    void SpscByteRing::copyIn(uint64_t index, const char *data, size_t numData)
+    {
+        //the data may wrap around the end of the ring
+        size_t
+            offset = index & _mask,
+            first = std::min(numData, (size_t) (_header->capacity - offset));
+
+        memcpy(&_data[offset], data, first);
+        memcpy(_data, data + first, numData - first);
+    }
+
+
+    void SpscByteRing::copyOut(uint64_t index, char *data, size_t numData)
+    {
+        size_t
+            offset = index & _mask,
+            first = std::min(numData, (size_t) (_header->capacity - offset));
+
+        memcpy(data, &_data[offset], first);
+        memcpy(data + first, _data, numData - first);
+    }
+
+
+    bool SpscByteRing::wait(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiting, const std::function<bool()>& ready, double timeoutSeconds, bool spin)
+    {
+        Time deadline = curtime() + std::chrono::microseconds((long) (timeoutSeconds * 1000000));
+        bool result = true;
+        while(!ready())
+        {
+            Time now = curtime();
+            if(timeoutSeconds >= 0 && now >= deadline)
+            {
+                result = false;
+                break;
+            }
+
+            if(spin)
+            {
+                #if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+                #endif
+                continue;
+            }
+
+            #if defined(USE_LINUX)
+            //announce the wait, then check again so that a notify() in between is not missed
+            uint32_t seq = signal.load();
+            waiting.store(1);
+            if(ready())
+            {
+                break;
+            }
+
+            double remaining = std::chrono::duration<double>(deadline - now).count();
+            timespec to;
+            to.tv_sec = (time_t) remaining;
+            to.tv_nsec = (long) ((remaining - (double) to.tv_sec) * 1000000000);
+
+            //not FUTEX_PRIVATE_FLAG, because the ring may be shared with another process
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&signal), FUTEX_WAIT, seq, (timeoutSeconds < 0 ? nullptr : &to), nullptr, 0);
+            #else
+            std::this_thread::yield();
+            #endif
+        }
+
+        waiting.store(0);
+        return result;
+    }
+
+
+    void SpscByteRing::notify(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiting)
+    {
+        signal.fetch_add(1);
+
+        #if defined(USE_LINUX)
+        if(waiting.load())
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&signal), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+        }
+        #endif
+    }
+}
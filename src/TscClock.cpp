@@ -0,0 +1,123 @@
+#include "serial_library/serial_library_base.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SIZEOF_INT128__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define TSC_AVAILABLE
+#endif
+
+// how long calibration watches both clocks. longer is more accurate, but delays the first read by as much
+#define TSC_CALIBRATION_NS 10000000
+#define TSC_MULTIPLIER_SHIFT 32
+#define TSC_PAIRED_READ_TRIES 16
+
+namespace serial_library
+{
+    #if defined(TSC_AVAILABLE)
+    __extension__ typedef __int128 int128;
+    __extension__ typedef unsigned __int128 uint128;
+    #endif
+
+    static int64_t steadyNanoseconds(void)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+
+    #if defined(TSC_AVAILABLE)
+    // reads steady_clock between two counter reads and keeps the tightest of a few tries, so that an interrupt or a
+    // slow clock read does not skew the pairing. ticks is set to the counter value halfway through the read
+    static int64_t pairedRead(uint64_t& ticks)
+    {
+        uint64_t bestSpan = UINT64_MAX;
+        int64_t nanoseconds = 0;
+        for(int i = 0; i < TSC_PAIRED_READ_TRIES; i++)
+        {
+            uint64_t before = __rdtsc();
+            int64_t steady = steadyNanoseconds();
+            uint64_t after = __rdtsc();
+            if(after - before < bestSpan)
+            {
+                bestSpan = after - before;
+                ticks = before + bestSpan / 2;
+                nanoseconds = steady;
+            }
+        }
+
+        return nanoseconds;
+    }
+    #endif
+
+
+    static TscClock::Calibration calibrate(void)
+    {
+        TscClock::Calibration calibration;
+        memset(&calibration, 0, sizeof(calibration));
+
+        #if defined(TSC_AVAILABLE)
+        //cpuid 0x80000007 edx bit 8: the counter ticks at a constant rate in every power state and on every core
+        unsigned int eax, ebx, ecx, edx;
+        if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+        {
+            return calibration;
+        }
+
+        //watch both clocks for a while, then divide how far each went
+        uint64_t
+            startTicks,
+            endTicks;
+
+        int64_t
+            startNs = pairedRead(startTicks),
+            endNs;
+
+        do
+        {
+            endNs = pairedRead(endTicks);
+        } while(endNs - startNs < TSC_CALIBRATION_NS);
+
+        calibration.usable = (endTicks > startTicks);
+        calibration.baseTicks = endTicks;
+        calibration.baseNanoseconds = endNs;
+        calibration.shift = TSC_MULTIPLIER_SHIFT;
+        calibration.multiplier = (calibration.usable ? (uint64_t) (((uint128) (endNs - startNs) << TSC_MULTIPLIER_SHIFT) / (endTicks - startTicks)) : 0);
+        #endif
+
+        return calibration;
+    }
+
+
+    const TscClock::Calibration& TscClock::calibration(void)
+    {
+        static const Calibration calibration = calibrate();
+        return calibration;
+    }
+
+
+    uint64_t TscClock::ticks(void)
+    {
+        #if defined(TSC_AVAILABLE)
+        return __rdtsc();
+        #else
+        return 0;
+        #endif
+    }
+
+
+    TscClock::time_point TscClock::now(void)
+    {
+        const Calibration& calibration = TscClock::calibration();
+        if(!calibration.usable)
+        {
+            return time_point(duration(steadyNanoseconds()));
+        }
+
+        #if defined(TSC_AVAILABLE)
+        //signed, since a core can read slightly behind the one that calibrated
+        int128 elapsedTicks = (int64_t) (ticks() - calibration.baseTicks);
+        return time_point(duration(calibration.baseNanoseconds + (int64_t) ((elapsedTicks * calibration.multiplier) >> calibration.shift)));
+        #else
+        return time_point(duration(steadyNanoseconds()));
+        #endif
+    }
+}
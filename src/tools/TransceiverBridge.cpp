@@ -1,4 +1,5 @@
 #include "serial_library/serial_library.hpp"
+#include <thread>
 
 #if defined(USE_ROS)
 #include <rclcpp/rclcpp.hpp>
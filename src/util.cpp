@@ -22,6 +22,43 @@ namespace serial_library
 
     #endif
 
+    #if defined(USE_LINUX)
+
+    bool toIovecs(const SerialIoVec *vecs, size_t numVecs, iovec *iovs, size_t maxIovs)
+    {
+        if(numVecs > maxIovs)
+        {
+            return false;
+        }
+
+        for(size_t i = 0; i < numVecs; i++)
+        {
+            iovs[i].iov_base = vecs[i].data;
+            iovs[i].iov_len = vecs[i].numData;
+        }
+
+        return true;
+    }
+
+
+    bool toIovecs(const SerialConstIoVec *vecs, size_t numVecs, iovec *iovs, size_t maxIovs)
+    {
+        if(numVecs > maxIovs)
+        {
+            return false;
+        }
+
+        for(size_t i = 0; i < numVecs; i++)
+        {
+            iovs[i].iov_base = (void*) vecs[i].data;
+            iovs[i].iov_len = vecs[i].numData;
+        }
+
+        return true;
+    }
+
+    #endif
+
     string wStringToString(const std::wstring& wstr)
     {
         static char b[1024];
@@ -250,4 +287,39 @@ namespace serial_library
 
         return normalizedFrameMap;
     }
+
+
+    size_t deltaFrameHeaderLength(const SerialFrame& frame)
+    {
+        size_t headerLen = 0;
+        for(size_t i = 0; i < frame.size(); i++)
+        {
+            if(frame[i] == FIELD_SYNC || frame[i] == FIELD_FRAME)
+            {
+                headerLen = i + 1;
+            }
+        }
+
+        return headerLen;
+    }
+
+
+    vector<SerialFieldId> deltaFrameFields(const SerialFrame& frame)
+    {
+        vector<SerialFieldId> fields;
+        for(SerialFieldId field : frame)
+        {
+            if(field == FIELD_SYNC || field == FIELD_FRAME || field == FIELD_CHECKSUM)
+            {
+                continue;
+            }
+
+            if(find(fields.begin(), fields.end(), field) == fields.end())
+            {
+                fields.push_back(field);
+            }
+        }
+
+        return fields;
+    }
 }
@@ -0,0 +1,137 @@
+#include "serial_library/serial_library.hpp"
+#include "serial_library/coroutines.hpp"
+#include "serial_library/testing.hpp"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+using namespace serial_library;
+
+// runs eagerly and is never awaited, which is all the tests need
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object(void) { return DetachedTask(); }
+        std::suspend_never initial_suspend(void) noexcept { return {}; }
+        std::suspend_never final_suspend(void) noexcept { return {}; }
+        void return_void(void) { }
+        void unhandled_exception(void) { std::terminate(); }
+    };
+};
+
+
+TEST_F(Type1SerialProcessorTest, TestCoroutineAwaitsFrame)
+{
+    char received = 0;
+    auto waitForFrame = [] (SerialProcessor& processor, char& received) -> DetachedTask {
+        SerialValuesMap values = co_await nextFrame(processor, TYPE_1_FRAME_1);
+        received = convertData<char>(values.at(TYPE_1_FRAME_1_FIELD_3));
+    };
+
+    waitForFrame(*processor, received);
+    ASSERT_EQ(received, 0);
+
+    //resumed from inside update()
+    client->send("Aqwe", 4);
+    processor->update(curtime());
+    ASSERT_EQ(received, 'e');
+}
+
+
+TEST_F(Type1SerialProcessorTest, TestCoroutineRequestAndStream)
+{
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_1, 'a', curtime());
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_2, 'b', curtime());
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_3, 'c', curtime());
+
+    std::string seen;
+    auto exchange = [] (SerialProcessor& processor, std::string& seen) -> DetachedTask {
+        FrameStream stream(processor, TYPE_1_FRAME_1);
+        SerialValuesMap ack = co_await request(processor, TYPE_1_FRAME_1, TYPE_1_FRAME_1);
+        seen += convertData<char>(ack.at(TYPE_1_FRAME_1_FIELD_3));
+
+        //the stream queued the ack too, and keeps going after it
+        for(int i = 0; i < 3; i++)
+        {
+            SerialValuesMap values = co_await stream.next();
+            seen += convertData<char>(values.at(TYPE_1_FRAME_1_FIELD_3));
+        }
+    };
+
+    exchange(*processor, seen);
+
+    //the request went out when the coroutine suspended
+    char buf[4];
+    ASSERT_EQ(client->recv(buf, sizeof(buf)), sizeof(buf));
+    ASSERT_TRUE(memcmp(buf, "Aabc", 4) == 0);
+
+    client->send("Aok!", 4);
+    processor->update(curtime());
+    ASSERT_EQ(seen, "!!");
+
+    client->send("Axy1Axy2", 8);
+    processor->update(curtime());
+    ASSERT_EQ(seen, "!!12");
+}
+
+
+TEST_F(Type1SerialProcessorTest, TestCoroutinesOnReceiveThread)
+{
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_1, 'a', curtime());
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_2, 'b', curtime());
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_3, 'c', curtime());
+    processor->start();
+
+    //the device answers every command, and chatters on its own once asked to
+    std::atomic<bool>
+        deviceRunning(true),
+        chatter(false);
+
+    std::thread device([this, &deviceRunning, &chatter] () {
+        char buf[4];
+        while(deviceRunning)
+        {
+            if(chatter)
+            {
+                client->send("Axyz", 4);
+                std::this_thread::yield();
+            } else if(client->waitForData(0.01) && client->recv(buf, sizeof(buf)) == sizeof(buf))
+            {
+                client->send("Aok!", 4);
+            }
+        }
+    });
+
+    //after the first response, the coroutine resumes and sends its next request from the receive thread, often
+    //before the awaiter that sent it has returned from await_suspend()
+    std::atomic<int> completed(0);
+    auto exchange = [] (SerialProcessor& processor, std::atomic<int>& completed) -> DetachedTask {
+        for(int i = 0; i < 200; i++)
+        {
+            co_await request(processor, TYPE_1_FRAME_1, TYPE_1_FRAME_1);
+            completed++;
+        }
+    };
+
+    exchange(*processor, completed);
+    for(int i = 0; i < 500 && completed < 200; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    int numCompleted = completed;
+
+    //streams are torn down here while the receive thread feeds them
+    chatter = true;
+    for(int i = 0; i < 200; i++)
+    {
+        FrameStream stream(*processor, TYPE_1_FRAME_1);
+    }
+
+    deviceRunning = false;
+    device.join();
+    processor->stop();
+    ASSERT_EQ(numCompleted, 200);
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "serial_library/serial_library.hpp"
 #include "serial_library/testing.hpp"
+#include <thread>
 
 TEST(IntraProcessTransceiverTest, TestIntraProcessTransceiverHasPartner)
 {
@@ -106,4 +107,263 @@ TEST(IntraProcessTransceiverTest, TestIntraProcessTransceiverBidirectional)
 
     t1->deinit();
     t2->deinit();
-}
\ No newline at end of file
+}
+
+TEST(IntraProcessTransceiverTest, TestIntraProcessTransceiverVectoredIO)
+{
+    //intra-process transceivers use the default sendv() and recvv()
+    auto t1 = std::make_shared<serial_library::IntraProcessTransceiver>();
+    auto t2 = std::make_shared<serial_library::IntraProcessTransceiver>();
+
+    ASSERT_TRUE(t1->init() && t2->init());
+    ASSERT_FALSE(t1->capabilities() & serial_library::TRANSCEIVER_CAP_VECTORED_IO);
+
+    t1->getChannel()->setPartner(t2->getChannel());
+    t2->getChannel()->setPartner(t1->getChannel());
+
+    const serial_library::SerialConstIoVec out[] = {
+        {"head", 4},
+        {"payload", 7}
+    };
+
+    t1->sendv(out, 2);
+
+    char
+        head[4],
+        payload[16];
+    
+    const serial_library::SerialIoVec in[] = {
+        {head, sizeof(head)},
+        {payload, sizeof(payload)}
+    };
+
+    size_t recvd = t2->recvv(in, 2);
+    ASSERT_EQ(recvd, 11);
+    ASSERT_EQ("head", std::string(head, sizeof(head)));
+    ASSERT_EQ("payload", std::string(payload, 7));
+
+    t1->deinit();
+    t2->deinit();
+}
+
+#if defined(USE_LINUX)
+
+TEST(IntraProcessTransceiverTest, TestIntraProcessTransceiverReadiness)
+{
+    auto t1 = std::make_shared<serial_library::IntraProcessTransceiver>();
+    auto t2 = std::make_shared<serial_library::IntraProcessTransceiver>();
+
+    ASSERT_TRUE(t1->init() && t2->init());
+    ASSERT_TRUE(t2->capabilities() & serial_library::TRANSCEIVER_CAP_NATIVE_HANDLE);
+    ASSERT_NE(t2->nativeHandle(), INVALID_NATIVE_HANDLE);
+
+    t1->getChannel()->setPartner(t2->getChannel());
+    t2->getChannel()->setPartner(t1->getChannel());
+
+    //nothing sent yet
+    ASSERT_FALSE(t2->waitForData(0.01));
+
+    const std::string msg = "ready";
+    t1->send(msg.c_str(), msg.length());
+    ASSERT_TRUE(t2->waitForData(0.01));
+
+    //partial read leaves the channel readable
+    char buffer[64];
+    ASSERT_EQ(t2->recv(buffer, 2), 2);
+    ASSERT_TRUE(t2->waitForData(0));
+
+    //draining the channel clears readiness
+    ASSERT_EQ(t2->recv(buffer, sizeof(buffer)), 3);
+    ASSERT_FALSE(t2->waitForData(0));
+
+    t1->deinit();
+    t2->deinit();
+}
+
+#endif
+
+TEST(IntraProcessTransceiverTest, TestIntraProcessChannelOverflow)
+{
+    auto dropNewest = std::make_shared<serial_library::IntraProcessChannel>(8, serial_library::OVERFLOW_DROP_NEWEST);
+    auto dropOldest = std::make_shared<serial_library::IntraProcessChannel>(8, serial_library::OVERFLOW_DROP_OLDEST);
+    serial_library::IntraProcessTransceiver
+        newestReader(dropNewest),
+        oldestReader(dropOldest),
+        newestWriter,
+        oldestWriter;
+    
+    newestWriter.getChannel()->setPartner(dropNewest);
+    oldestWriter.getChannel()->setPartner(dropOldest);
+    const std::string msgs[] = { "abcd", "efgh", "ijkl" };
+    for(const std::string& msg : msgs)
+    {
+        newestWriter.send(msg.c_str(), msg.length());
+        oldestWriter.send(msg.c_str(), msg.length());
+    }
+
+    char buffer[16];
+    size_t recvd = newestReader.recv(buffer, sizeof(buffer));
+    ASSERT_EQ("abcdefgh", std::string(buffer, recvd));
+    recvd = oldestReader.recv(buffer, sizeof(buffer));
+    ASSERT_EQ("efghijkl", std::string(buffer, recvd));
+
+    //either way, the lost bytes are counted
+    ASSERT_EQ(dropNewest->droppedBytes(), 4);
+    ASSERT_EQ(dropOldest->droppedBytes(), 4);
+}
+
+TEST(IntraProcessTransceiverTest, TestIntraProcessChannelBlocking)
+{
+    //reader blocks until data arrives, writer blocks until the reader makes room
+    auto channel = std::make_shared<serial_library::IntraProcessChannel>(16, serial_library::OVERFLOW_BLOCK, -1);
+    serial_library::IntraProcessTransceiver
+        reader(channel),
+        writer;
+    
+    writer.getChannel()->setPartner(channel);
+
+    const size_t total = 100000;
+    std::thread producer([&writer, total] () {
+        for(size_t i = 0; i < total; i++)
+        {
+            char c = (char) (i % 251);
+            writer.send(&c, 1);
+        }
+    });
+
+    size_t received = 0;
+    bool inOrder = true;
+    char buffer[16];
+    while(received < total)
+    {
+        size_t recvd = reader.recv(buffer, sizeof(buffer));
+        for(size_t i = 0; i < recvd; i++)
+        {
+            inOrder = inOrder && buffer[i] == (char) ((received + i) % 251);
+        }
+
+        received += recvd;
+    }
+
+    producer.join();
+    ASSERT_EQ(received, total);
+    ASSERT_TRUE(inOrder);
+}
+
+TEST(IntraProcessTransceiverTest, TestIntraProcessChannelBlockingTimesOut)
+{
+    //nobody reads, so the second send gives up after the send timeout instead of hanging
+    auto channel = std::make_shared<serial_library::IntraProcessChannel>(8, serial_library::OVERFLOW_BLOCK, 0, 0.05);
+    serial_library::IntraProcessTransceiver
+        reader(channel),
+        writer;
+    
+    writer.getChannel()->setPartner(channel);
+    writer.send("abcdefgh", 8);
+
+    serial_library::Time start = serial_library::curtime();
+    writer.send("ijkl", 4);
+    double waited = std::chrono::duration<double>(serial_library::curtime() - start).count();
+    ASSERT_GE(waited, 0.04);
+    ASSERT_LT(waited, 5);
+    ASSERT_EQ(channel->droppedBytes(), 4);
+
+    char buffer[16];
+    size_t recvd = reader.recv(buffer, sizeof(buffer));
+    ASSERT_EQ("abcdefgh", std::string(buffer, recvd));
+}
+
+TEST(IntraProcessTransceiverTest, TestIntraProcessBroadcastChannel)
+{
+    auto channel = std::make_shared<serial_library::IntraProcessBroadcastChannel>(8);
+    serial_library::IntraProcessBroadcastTransceiver publisher(channel, true);
+    auto parser = channel->subscribe();
+    auto logger = channel->subscribe();
+
+    publisher.send("abc", 3);
+    char buffer[16];
+    size_t recvd = parser->recv(buffer, sizeof(buffer));
+    ASSERT_EQ("abc", std::string(buffer, recvd));
+    recvd = logger->recv(buffer, sizeof(buffer));
+    ASSERT_EQ("abc", std::string(buffer, recvd));
+
+    //late subscribers only see new data
+    auto visualizer = channel->subscribe();
+    ASSERT_EQ(visualizer->recv(buffer, sizeof(buffer)), 0);
+
+    //the logger falls behind by more than the ring and skips to the oldest data left
+    publisher.send("defgh", 5);
+    recvd = parser->recv(buffer, sizeof(buffer));
+    ASSERT_EQ("defgh", std::string(buffer, recvd));
+    publisher.send("ijklmn", 6);
+    recvd = parser->recv(buffer, sizeof(buffer));
+    ASSERT_EQ("ijklmn", std::string(buffer, recvd));
+    recvd = logger->recv(buffer, sizeof(buffer));
+    ASSERT_EQ("ghijklmn", std::string(buffer, recvd));
+    ASSERT_EQ(logger->lostBytes(), 3);
+    ASSERT_EQ(parser->lostBytes(), 0);
+    ASSERT_EQ(publisher.recv(buffer, sizeof(buffer)), 0);
+
+    auto disconnecting = std::make_shared<serial_library::IntraProcessBroadcastChannel>(8, serial_library::LAP_DISCONNECT);
+    auto slow = disconnecting->subscribe();
+    disconnecting->send("012345", 6);
+    disconnecting->send("6789ab", 6);
+    ASSERT_EQ(slow->recv(buffer, sizeof(buffer)), 0);
+    ASSERT_TRUE(slow->disconnected());
+}
+
+TEST(IntraProcessTransceiverTest, TestIntraProcessBroadcastChannelConcurrent)
+{
+    //readers never see torn data: whatever they receive continues where their cursor left off
+    auto channel = std::make_shared<serial_library::IntraProcessBroadcastChannel>(256);
+    auto fast = channel->subscribe();
+    auto slow = channel->subscribe();
+    const size_t total = 1000000;
+    std::atomic<bool> done(false);
+
+    std::thread writer([&channel, &done, total] () {
+        char chunk[37];
+        for(size_t i = 0; i < total; i += sizeof(chunk))
+        {
+            for(size_t j = 0; j < sizeof(chunk); j++)
+            {
+                chunk[j] = (char) ((i + j) % 251);
+            }
+
+            channel->send(chunk, sizeof(chunk));
+        }
+
+        done = true;
+    });
+
+    size_t fastReceived = 0, slowReceived = 0;
+    bool fastOk = true, slowOk = true;
+    char buffer[64];
+    auto check = [&buffer] (const std::shared_ptr<serial_library::IntraProcessBroadcastTransceiver>& sub, size_t& received, bool& ok, size_t max) {
+        size_t recvd = sub->recv(buffer, max);
+        size_t start = received + sub->lostBytes();
+        for(size_t i = 0; i < recvd; i++)
+        {
+            ok = ok && buffer[i] == (char) ((start + i) % 251);
+        }
+
+        received += recvd;
+        return recvd;
+    };
+
+    while(!done)
+    {
+        check(fast, fastReceived, fastOk, sizeof(buffer));
+        check(slow, slowReceived, slowOk, 3);
+    }
+
+    writer.join();
+    while(check(fast, fastReceived, fastOk, sizeof(buffer)) + check(slow, slowReceived, slowOk, sizeof(buffer)) > 0) { }
+    ASSERT_TRUE(fastOk);
+    ASSERT_TRUE(slowOk);
+
+    //everything sent was either received or counted as lost
+    size_t sent = (total + 36) / 37 * 37;
+    ASSERT_EQ(fastReceived + fast->lostBytes(), sent);
+    ASSERT_EQ(slowReceived + slow->lostBytes(), sent);
+}
@@ -0,0 +1,71 @@
+#include "serial_library/serial_library.hpp"
+#include "serial_library/testing.hpp"
+
+#if defined(USE_LINUX)
+
+// these pass with or without kernel io_uring support, because the transceivers fall back to the ones they wrap
+
+TEST_F(LinuxTransceiverTest, TestIoUringStreamLinks)
+{
+    auto engine = std::make_shared<serial_library::LinuxIoUringEngine>();
+    auto pair1 = std::make_shared<serial_library::LinuxSocketpairTransceiver>(AF_UNIX, SOCK_STREAM);
+    ASSERT_TRUE(pair1->init());
+    auto pair2 = std::make_shared<serial_library::LinuxSocketpairTransceiver>(pair1->childFd());
+
+    serial_library::LinuxIoUringTransceiver
+        trans1(pair1, engine, 0.1),
+        trans2(pair2, engine, 0.1);
+    
+    ASSERT_TRUE(trans1.init());
+    ASSERT_TRUE(trans2.init());
+
+    //sends on both links go out together
+    trans1.send("hel", 3);
+    trans1.send("lo", 2);
+    trans2.send("abc", 3);
+    engine->flush();
+
+    ASSERT_TRUE(trans2.waitForData(1));
+    char buf[32];
+    size_t s = trans2.recv(buf, sizeof(buf));
+    ASSERT_EQ("hello", std::string(buf, s));
+
+    ASSERT_TRUE(trans1.waitForData(1));
+    s = trans1.recv(buf, sizeof(buf));
+    ASSERT_EQ("abc", std::string(buf, s));
+
+    ASSERT_FALSE(trans1.waitForData(0.05));
+    ASSERT_EQ(trans1.recv(buf, sizeof(buf)), 0);
+
+    trans1.deinit();
+    trans2.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestIoUringDatagramLinks)
+{
+    auto engine = std::make_shared<serial_library::LinuxIoUringEngine>();
+    serial_library::LinuxIoUringTransceiver
+        trans1(std::make_shared<serial_library::LinuxUDPTransceiver>("localhost", 9982, 0.1, false, false, true), engine, 0.1),
+        trans2(std::make_shared<serial_library::LinuxUDPTransceiver>("localhost", 9982, 0.1, false, false, true), engine, 0.1);
+    
+    ASSERT_TRUE(trans1.init());
+    ASSERT_TRUE(trans2.init());
+
+    trans1.send("first", 5);
+    trans1.send("second", 6);
+    engine->flush();
+
+    //datagrams keep their boundaries
+    char buf[32];
+    ASSERT_TRUE(trans2.waitForData(1));
+    size_t s = trans2.recv(buf, sizeof(buf));
+    ASSERT_EQ("first", std::string(buf, s));
+    ASSERT_TRUE(trans2.waitForData(1));
+    s = trans2.recv(buf, sizeof(buf));
+    ASSERT_EQ("second", std::string(buf, s));
+
+    trans1.deinit();
+    trans2.deinit();
+}
+
+#endif
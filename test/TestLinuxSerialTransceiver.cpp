@@ -28,10 +28,10 @@ TEST_F(LinuxTransceiverTest, TestTransceiverRdWr)
     transceiver2.init();
     transceiver1.send(expectedMsg1.c_str(), expectedMsg1.length());
     size_t recvd1 = transceiver2.recv(buf, sizeof(buf));
-    std::string msg1((char*) buf);
+    std::string msg1(buf, recvd1);
     transceiver2.send(expectedMsg2.c_str(), expectedMsg2.length());
     size_t recvd2 = transceiver1.recv(buf, sizeof(buf));
-    std::string msg2((char*) buf);
+    std::string msg2(buf, recvd2);
     transceiver1.deinit();
     transceiver2.deinit();
 
@@ -66,10 +66,10 @@ TEST_F(LinuxTransceiverTest, TestTransceiverRoWo)
     transceiver2.init();
     transceiver1.send(expectedMsg.c_str(), expectedMsg.length());
     size_t recvd1 = transceiver2.recv(buf, sizeof(buf));
-    std::string msg1(buf);
+    std::string msg1(buf, recvd1);
     transceiver2.send("stuff", sizeof("stuff"));
-    transceiver1.recv(buf, sizeof(buf));
-    std::string msg2(buf);
+    size_t recvd2 = transceiver1.recv(buf, sizeof(buf));
+    std::string msg2(buf, recvd2);
     transceiver1.deinit();
     transceiver2.deinit();
 
@@ -78,4 +78,73 @@ TEST_F(LinuxTransceiverTest, TestTransceiverRoWo)
     ASSERT_EQ("", msg2);
 }
 
+TEST_F(LinuxTransceiverTest, TestTransceiverLowLatencyOptions)
+{
+    serial_library::LinuxSerialTransceiverOptions options;
+    options.lowLatency = true;
+    options.readTimeoutMicroseconds = 2000;
+
+    //250000 has no B* constant, so it goes through termios2
+    serial_library::LinuxSerialTransceiver
+        transceiver1(homeDir() + "virtualsp1", 250000, 1, 0, O_RDWR, CS8, false, false, options),
+        transceiver2(homeDir() + "virtualsp2", 921600, 1, 0, O_RDWR, CS8, false, false, options);
+    
+    ASSERT_TRUE(transceiver1.init());
+    ASSERT_TRUE(transceiver2.init());
+    ASSERT_EQ(serial_library::getBaud(transceiver1.nativeHandle()), 250000);
+    ASSERT_EQ(serial_library::getBaud(transceiver2.nativeHandle()), 921600);
+
+    //polled reads time out in microseconds instead of tenths of a second
+    char buf[64];
+    auto start = std::chrono::system_clock::now();
+    ASSERT_EQ(transceiver2.recv(buf, sizeof(buf)), 0);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - start);
+    ASSERT_LT(elapsed.count(), 20000);
+
+    transceiver1.send("fast", 4);
+    std::string received;
+    for(int i = 0; i < 100 && received.length() < 4; i++)
+    {
+        size_t s = transceiver2.recv(buf, sizeof(buf));
+        received += std::string(buf, s);
+    }
+
+    ASSERT_EQ("fast", received);
+    transceiver1.deinit();
+    transceiver2.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestTransceiverNonBlockingSendIsComplete)
+{
+    //far more than the pty buffers, so non-blocking writes come up short and have to be picked up
+    serial_library::LinuxSerialTransceiver
+        transceiver1(homeDir() + "virtualsp1", 921600, 1, 0, O_RDWR | O_NONBLOCK),
+        transceiver2(homeDir() + "virtualsp2", 921600, 1, 0);
+
+    ASSERT_TRUE(transceiver1.init());
+    ASSERT_TRUE(transceiver2.init());
+
+    std::string sent(1 << 16, 0);
+    for(size_t i = 0; i < sent.length(); i++)
+    {
+        sent[i] = (char) ('a' + i % 26);
+    }
+
+    std::string received;
+    std::thread reader([&transceiver2, &received, &sent] () {
+        char buf[4096];
+        while(received.length() < sent.length())
+        {
+            received += std::string(buf, transceiver2.recv(buf, sizeof(buf)));
+        }
+    });
+
+    transceiver1.send(sent.c_str(), sent.length());
+    reader.join();
+    ASSERT_EQ(sent, received);
+    ASSERT_EQ(transceiver1.outputBacklog(), 0);
+    transceiver1.deinit();
+    transceiver2.deinit();
+}
+
 #endif
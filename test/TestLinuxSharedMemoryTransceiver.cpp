@@ -0,0 +1,116 @@
+#include "serial_library/serial_library.hpp"
+#include "serial_library/testing.hpp"
+
+using namespace std::chrono_literals;
+
+TEST(SpscByteRingTest, TestSpscByteRingWrapAround)
+{
+    alignas(64) char region[1024];
+    serial_library::SpscByteRing ring;
+    ASSERT_EQ(serial_library::SpscByteRing::regionSize(10) - serial_library::SpscByteRing::regionSize(16), 0);
+    ASSERT_EQ(serial_library::SpscByteRing::regionSize(16) % 64, 0);
+    ASSERT_TRUE(ring.attach(region, sizeof(region), true, 16));
+    ASSERT_EQ(ring.capacity(), 16);
+
+    //all or nothing
+    ASSERT_FALSE(ring.write("01234567890123456", 17));
+    ASSERT_TRUE(ring.write("0123456789", 10));
+    ASSERT_FALSE(ring.write("abcdefg", 7));
+    ASSERT_FALSE(ring.waitWritable(7, 0.01));
+
+    char buf[32];
+    ASSERT_EQ(ring.read(buf, 8), 8);
+    ASSERT_EQ("01234567", std::string(buf, 8));
+
+    //crosses the end of the ring
+    ASSERT_TRUE(ring.write("abcdefghij", 10));
+    ASSERT_EQ(ring.readable(), 12);
+    ASSERT_EQ(ring.read(buf, sizeof(buf)), 12);
+    ASSERT_EQ("89abcdefghij", std::string(buf, 12));
+    ASSERT_FALSE(ring.waitReadable(0.01));
+
+    //a second view of the same region sees the same ring
+    serial_library::SpscByteRing other;
+    ASSERT_TRUE(other.attach(region, sizeof(region), false));
+    ASSERT_TRUE(ring.write("xyz", 3));
+    ASSERT_TRUE(other.waitReadable(0));
+    ASSERT_EQ(other.read(buf, sizeof(buf)), 3);
+}
+
+#if defined(USE_LINUX)
+
+TEST_F(LinuxTransceiverTest, TestSharedMemoryTransceiver)
+{
+    serial_library::LinuxSharedMemoryTransceiver trans1(serial_library::SHM_WAIT_FUTEX, 4096);
+    ASSERT_TRUE(trans1.init());
+
+    pid_t p = fork();
+    ASSERT_NE(p, -1);
+
+    char buf[32];
+    if(p == 0)
+    {
+        // child echoes one message back
+        serial_library::LinuxSharedMemoryTransceiver trans2(trans1.childFd(), serial_library::SHM_WAIT_FUTEX, 1);
+        trans2.init();
+        size_t s = trans2.recv(buf, sizeof(buf));
+        serial_library::SerialConstIoVec pieces[2] = { { "re: ", 4 }, { buf, s } };
+        trans2.sendv(pieces, 2);
+        exit(0);
+    }
+
+    trans1.send("ping", 4);
+    ASSERT_TRUE(trans1.waitForData(2));
+    size_t s = trans1.recv(buf, sizeof(buf));
+    ASSERT_EQ("re: ping", std::string(buf, s));
+
+    int ret = waitpid(p, NULL, 0);
+    ASSERT_NE(ret, -1);
+    trans1.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestSharedMemoryTransceiverSpin)
+{
+    serial_library::LinuxSharedMemoryTransceiver trans1(serial_library::SHM_WAIT_SPIN, 4096, 0.05);
+    ASSERT_TRUE(trans1.init());
+    serial_library::LinuxSharedMemoryTransceiver trans2(dup(trans1.childFd()), serial_library::SHM_WAIT_SPIN, 0.05);
+    ASSERT_TRUE(trans2.init());
+
+    char buf[32];
+    ASSERT_EQ(trans2.recv(buf, sizeof(buf)), 0);
+    trans1.send("hello", 5);
+    size_t s = trans2.recv(buf, sizeof(buf));
+    ASSERT_EQ("hello", std::string(buf, s));
+    trans2.send("world", 5);
+    s = trans1.recv(buf, sizeof(buf));
+    ASSERT_EQ("world", std::string(buf, s));
+
+    trans2.deinit();
+    trans1.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestSharedMemoryTransceiverSmallRingSendTimeout)
+{
+    //the second ring of a tiny region still starts on a cache line
+    serial_library::LinuxSharedMemoryTransceiver trans1(serial_library::SHM_WAIT_FUTEX, 16, 1, 0.02);
+    ASSERT_TRUE(trans1.init());
+    serial_library::LinuxSharedMemoryTransceiver trans2(dup(trans1.childFd()), serial_library::SHM_WAIT_FUTEX, 1, 0.02);
+    ASSERT_TRUE(trans2.init());
+
+    char buf[32];
+    trans2.send("0123456789abcdef", 16);
+    ASSERT_EQ(trans1.recv(buf, sizeof(buf)), 16);
+
+    //a full ring holds up send() for the send timeout, not the much longer receive timeout
+    trans1.send("0123456789abcdef", 16);
+    serial_library::Time start = serial_library::curtime();
+    trans1.send("x", 1);
+    ASSERT_LT(serial_library::curtime() - start, 500ms);
+    ASSERT_EQ(trans2.recv(buf, sizeof(buf)), 16);
+    ASSERT_EQ("0123456789abcdef", std::string(buf, 16));
+
+    trans2.deinit();
+    trans1.deinit();
+}
+
+#endif
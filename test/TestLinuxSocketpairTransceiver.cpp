@@ -36,4 +36,47 @@ TEST_F(LinuxTransceiverTest, TestSocketpair)
     ASSERT_EQ(s, 0);
 }
 
+TEST_F(LinuxTransceiverTest, TestSocketpairVectoredIO)
+{
+    serial_library::LinuxSocketpairTransceiver trans1(AF_UNIX, SOCK_STREAM);
+    ASSERT_TRUE(trans1.init());
+    ASSERT_TRUE(trans1.capabilities() & serial_library::TRANSCEIVER_CAP_VECTORED_IO);
+
+    //other end of the pair, in the same process
+    serial_library::LinuxSocketpairTransceiver trans2(trans1.childFd());
+    ASSERT_TRUE(trans2.init());
+
+    const serial_library::SerialConstIoVec out[] = {
+        {"hel", 3},
+        {"lo w", 4},
+        {"orld", 4}
+    };
+
+    trans1.sendv(out, 3);
+
+    char
+        first[5],
+        second[16];
+    
+    memset(second, 'x', sizeof(second));
+    const serial_library::SerialIoVec in[] = {
+        {first, sizeof(first)},
+        {second, sizeof(second)}
+    };
+
+    size_t s = trans2.recvv(in, 2);
+    ASSERT_EQ(s, 11);
+    ASSERT_EQ("hello", std::string(first, sizeof(first)));
+    ASSERT_EQ(" world", std::string(second, 6));
+
+    //bytes past the received count are untouched
+    ASSERT_EQ(second[6], 'x');
+    trans2.send("abc", 3);
+    s = trans1.recv(second, sizeof(second));
+    ASSERT_EQ(s, 3);
+    ASSERT_EQ(second[3], 'r');
+
+    trans1.deinit();
+}
+
 #endif
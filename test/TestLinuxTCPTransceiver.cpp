@@ -0,0 +1,96 @@
+#include "serial_library/serial_library.hpp"
+#include "serial_library/testing.hpp"
+
+#if defined(USE_LINUX)
+
+TEST_F(LinuxTransceiverTest, TestTCPTransceiver)
+{
+    serial_library::LinuxTCPTransceiver
+        server("127.0.0.1", 9996, true, 0.1, true),
+        client("127.0.0.1", 9996, false, 0.1);
+    
+    ASSERT_TRUE(server.init());
+    ASSERT_TRUE(client.init());
+    ASSERT_TRUE(client.connected());
+    ASSERT_FALSE(server.waitForData(0.1)); // accepts the client, but nothing was sent yet
+    ASSERT_TRUE(server.connected());
+
+    char buf[64];
+    client.send("hello", 5);
+    ASSERT_TRUE(server.waitForData(1));
+    size_t s = server.recv(buf, sizeof(buf));
+    ASSERT_EQ("hello", std::string(buf, s));
+
+    //batched and vectored sends arrive as one ordered stream
+    serial_library::SerialConstIoVec pieces[3] = { { "one", 3 }, { "two", 3 }, { "three", 5 } };
+    server.sendPackets(pieces, 3);
+    server.sendv(pieces, 2);
+    std::string received;
+    while(received.length() < 17 && client.waitForData(1))
+    {
+        s = client.recv(buf, sizeof(buf));
+        received += std::string(buf, s);
+    }
+
+    ASSERT_EQ("onetwothreeonetwo", received);
+
+    //corked sends are held until uncorked
+    client.setCork(true);
+    client.send("a", 1);
+    client.send("b", 1);
+    client.setCork(false);
+    received.clear();
+    while(received.length() < 2 && server.waitForData(1))
+    {
+        s = server.recv(buf, sizeof(buf));
+        received += std::string(buf, s);
+    }
+
+    ASSERT_EQ("ab", received);
+
+    client.deinit();
+    server.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestTCPTransceiverReconnect)
+{
+    serial_library::LinuxTCPTransceiverOptions options;
+    options.reconnectIntervalSeconds = 0.05;
+    options.connectTimeoutSeconds = 0.1;
+
+    //client comes up before the server
+    serial_library::LinuxTCPTransceiver client("127.0.0.1", 9997, false, 0.1, false, options);
+    ASSERT_TRUE(client.init());
+    ASSERT_FALSE(client.connected());
+
+    char buf[32];
+    {
+        serial_library::LinuxTCPTransceiver server("127.0.0.1", 9997, true, 0.1, true);
+        ASSERT_TRUE(server.init());
+        usleep(100000);
+        ASSERT_TRUE(client.waitForData(0.1) || client.connected());
+        client.send("first", 5);
+        ASSERT_TRUE(server.waitForData(1));
+        size_t s = server.recv(buf, sizeof(buf));
+        ASSERT_EQ("first", std::string(buf, s));
+        server.deinit();
+    }
+
+    //the client notices that the server went away
+    ASSERT_EQ(client.recv(buf, sizeof(buf)), 0);
+    ASSERT_FALSE(client.connected());
+
+    serial_library::LinuxTCPTransceiver server("127.0.0.1", 9997, true, 0.1, true);
+    ASSERT_TRUE(server.init());
+    usleep(100000);
+    client.send("second", 6);
+    ASSERT_TRUE(client.connected());
+    ASSERT_TRUE(server.waitForData(1));
+    size_t s = server.recv(buf, sizeof(buf));
+    ASSERT_EQ("second", std::string(buf, s));
+
+    client.deinit();
+    server.deinit();
+}
+
+#endif
@@ -61,6 +61,38 @@ TEST_F(LinuxTransceiverTest, TestUDPTransceiverTimeout)
     ASSERT_NEAR(elapsed.count(), 1000, 100);
 }
 
+TEST_F(LinuxTransceiverTest, TestUDPTransceiverReadiness)
+{
+    serial_library::LinuxUDPTransceiver
+        transceiver1("localhost", 9978, 0.1, false, false, true),
+        transceiver2("localhost", 9978, 0.1, false, false, true);
+    
+    transceiver1.init();
+    transceiver2.init();
+
+    ASSERT_TRUE(transceiver2.capabilities() & serial_library::TRANSCEIVER_CAP_NATIVE_HANDLE);
+    ASSERT_NE(transceiver2.nativeHandle(), INVALID_NATIVE_HANDLE);
+
+    auto start = std::chrono::system_clock::now();
+    bool ready = transceiver2.waitForData(0.2);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - start);
+    ASSERT_FALSE(ready);
+    ASSERT_NEAR(elapsed.count(), 200, 50);
+
+    const std::string expected = "ready!";
+    transceiver1.send(expected.c_str(), expected.length());
+    ASSERT_TRUE(transceiver2.waitForData(1));
+
+    char buffer[50];
+    size_t recvd = transceiver2.recv(buffer, sizeof(buffer));
+    ASSERT_EQ(expected, std::string(buffer, recvd));
+    ASSERT_FALSE(transceiver2.waitForData(0));
+
+    transceiver1.deinit();
+    transceiver2.deinit();
+    ASSERT_EQ(transceiver2.nativeHandle(), INVALID_NATIVE_HANDLE);
+}
+
 TEST_F(LinuxTransceiverTest, TestUDPTransceiverBidirectional)
 {
     serial_library::LinuxDualUDPTransceiver
@@ -94,4 +126,392 @@ TEST_F(LinuxTransceiverTest, TestUDPTransceiverBidirectional)
     ASSERT_EQ(expected2.length(), recvd2);
 }
 
+TEST_F(LinuxTransceiverTest, TestUDPTransceiverBatched)
+{
+    serial_library::LinuxUDPTransceiverOptions options;
+    options.batchSize = 8;
+    options.recvBufferSize = 1 << 16;
+
+    serial_library::LinuxUDPTransceiver
+        transceiver1("localhost", 9980, 0.1, false, false, true, options),
+        transceiver2("localhost", 9980, 0.1, false, false, true, options);
+    
+    transceiver1.init();
+    transceiver2.init();
+    ASSERT_TRUE(transceiver2.capabilities() & serial_library::TRANSCEIVER_CAP_MESSAGE_BOUNDARIES);
+
+    const serial_library::SerialConstIoVec out[] = {
+        {"one", 3},
+        {"three", 5},
+        {"five!", 5}
+    };
+
+    transceiver1.sendPackets(out, 3);
+    ASSERT_TRUE(transceiver2.waitForData(1));
+
+    //only the first two fit, the third waits for the next call
+    char buffer[10];
+    serial_library::SerialPacketInfo packets[4];
+    size_t numPackets = transceiver2.recvPackets(buffer, sizeof(buffer), packets, 4);
+    ASSERT_EQ(numPackets, 2);
+    ASSERT_EQ(packets[0].offset, 0);
+    ASSERT_EQ(packets[0].length, 3);
+    ASSERT_EQ(packets[1].offset, 3);
+    ASSERT_EQ(packets[1].length, 5);
+    ASSERT_EQ("onethree", std::string(buffer, 8));
+
+    ASSERT_TRUE(transceiver2.waitForData(0));
+    size_t recvd = transceiver2.recv(buffer, sizeof(buffer));
+    ASSERT_EQ("five!", std::string(buffer, recvd));
+
+    ASSERT_EQ(transceiver2.recvPackets(buffer, sizeof(buffer), packets, 4), 0);
+
+    transceiver1.deinit();
+    transceiver2.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestUDPTransceiverHandleShowsLeftoverDatagrams)
+{
+    serial_library::LinuxUDPTransceiverOptions options;
+    options.batchSize = 8;
+    options.recvBufferSize = 1 << 16;
+
+    serial_library::LinuxUDPTransceiver
+        transceiver1("localhost", 9986, 0.1, false, false, true, options),
+        transceiver2("localhost", 9986, 0.1, false, false, true, options);
+    
+    transceiver1.init();
+    transceiver2.init();
+
+    //a burst larger than the processor's buffer is taken in by one recvmmsg(), but only part of it fits
+    std::string datagram(1500, 'x');
+    for(int i = 0; i < 4; i++)
+    {
+        transceiver1.send(datagram.c_str(), datagram.length());
+    }
+
+    pollfd pfd;
+    pfd.fd = transceiver2.nativeHandle();
+    pfd.events = POLLIN;
+    ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+
+    char buffer[PROCESSOR_BUFFER_SIZE];
+    serial_library::SerialPacketInfo packets[MAX_PACKET_BATCH];
+    size_t received = transceiver2.recvPackets(buffer, sizeof(buffer), packets, MAX_PACKET_BATCH);
+    ASSERT_EQ(received, 2);
+
+    //the socket is empty, but the handle still shows the rest
+    ASSERT_EQ(poll(&pfd, 1, 0), 1);
+    received += transceiver2.recvPackets(buffer, sizeof(buffer), packets, MAX_PACKET_BATCH);
+    ASSERT_EQ(received, 4);
+    ASSERT_EQ(poll(&pfd, 1, 0), 0);
+
+    transceiver1.deinit();
+    transceiver2.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestUDPTransceiverSegmentationOffload)
+{
+    serial_library::LinuxUDPTransceiverOptions options;
+    options.batchSize = 16;
+    options.useGso = true;
+    options.useGro = true;
+
+    serial_library::LinuxUDPTransceiver
+        transceiver1("localhost", 9981, 0.1, false, false, true, options),
+        transceiver2("localhost", 9981, 0.1, false, false, true, options);
+    
+    transceiver1.init();
+    transceiver2.init();
+
+    //datagrams that cannot be merged, then a run of equal-size ones followed by a shorter one
+    const size_t numEqual = 20;
+    std::vector<std::string> datagrams = { "a", "bb" };
+    std::vector<serial_library::SerialConstIoVec> out;
+    for(size_t i = 0; i < numEqual; i++)
+    {
+        datagrams.push_back(std::string(100, 'a' + i));
+    }
+
+    datagrams.push_back("short");
+    for(const std::string& datagram : datagrams)
+    {
+        out.push_back({datagram.c_str(), datagram.length()});
+    }
+
+    transceiver1.sendPackets(out.data(), out.size());
+
+    //however the stack merged them, they come back out one datagram at a time
+    char buffer[PROCESSOR_BUFFER_SIZE];
+    serial_library::SerialPacketInfo packets[MAX_PACKET_BATCH];
+    size_t received = 0;
+    while(received < datagrams.size() && transceiver2.waitForData(1))
+    {
+        size_t numPackets = transceiver2.recvPackets(buffer, sizeof(buffer), packets, MAX_PACKET_BATCH);
+        for(size_t i = 0; i < numPackets; i++, received++)
+        {
+            ASSERT_LT(received, datagrams.size());
+            ASSERT_EQ(datagrams[received], std::string(buffer + packets[i].offset, packets[i].length));
+        }
+    }
+
+    ASSERT_EQ(received, datagrams.size());
+    transceiver1.deinit();
+    transceiver2.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestUDPTransceiverCountsDroppedDatagrams)
+{
+    serial_library::LinuxUDPTransceiverOptions options;
+    options.useGso = true;
+
+    //nobody listens on the port, so the connected socket reports the refusal on a later send
+    serial_library::LinuxUDPTransceiver transceiver("localhost", 9984, 0.1, true, false, false, options);
+    transceiver.init();
+
+    const serial_library::SerialConstIoVec out[] = {
+        {"abc", 3},
+        {"def", 3}
+    };
+
+    size_t sends = 0;
+    while(transceiver.droppedDatagrams() == 0 && sends++ < 10)
+    {
+        transceiver.sendPackets(out, 2);
+        usleep(10000);
+    }
+
+    ASSERT_EQ(transceiver.droppedDatagrams(), 2);
+    transceiver.deinit();
+}
+
+// throughput of many small frames over loopback, with and without segmentation offload. Not run by default:
+//   ./test_serial_library --gtest_also_run_disabled_tests --gtest_filter=*BenchmarkUDP*
+TEST_F(LinuxTransceiverTest, DISABLED_BenchmarkUDPSegmentationOffload)
+{
+    const size_t 
+        frameSize = 64,
+        framesPerBatch = MAX_PACKET_BATCH,
+        numBatches = 20000;
+
+    std::string frame(frameSize, 'x');
+    std::vector<serial_library::SerialConstIoVec> out(framesPerBatch, {frame.c_str(), frame.length()});
+
+    for(bool offload : { false, true })
+    {
+        serial_library::LinuxUDPTransceiverOptions options;
+        options.batchSize = MAX_PACKET_BATCH;
+        options.recvBufferSize = 1 << 22;
+        options.useGso = offload;
+        options.useGro = offload;
+
+        serial_library::LinuxUDPTransceiver
+            sender("localhost", 9985, 0.1, false, false, true, options),
+            receiver("localhost", 9985, 0.1, false, false, true, options);
+        
+        sender.init();
+        receiver.init();
+
+        char buffer[PROCESSOR_BUFFER_SIZE];
+        serial_library::SerialPacketInfo packets[MAX_PACKET_BATCH];
+        size_t received = 0;
+        serial_library::Time start = serial_library::curtime();
+        for(size_t batch = 0; batch < numBatches; batch++)
+        {
+            sender.sendPackets(out.data(), out.size());
+            while(received < (batch + 1) * framesPerBatch && receiver.waitForData(0.1))
+            {
+                received += receiver.recvPackets(buffer, sizeof(buffer), packets, MAX_PACKET_BATCH);
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(serial_library::curtime() - start).count();
+        printf("%s: %zu of %zu frames in %f s, %.0f frames/s\n",
+            (offload ? "GSO/GRO" : "batched"), received, numBatches * framesPerBatch, seconds, received / seconds);
+        
+        sender.deinit();
+        receiver.deinit();
+    }
+}
+
+TEST_F(LinuxTransceiverTest, TestUDPTransceiverReceiveTimestamps)
+{
+    serial_library::LinuxUDPTransceiverOptions options;
+    options.receiveTimestamps = true;
+    serial_library::LinuxUDPTransceiver
+        transceiver1("localhost", 9983, 0.1, false, false, true, options),
+        transceiver2("localhost", 9983, 0.1, false, false, true, options);
+    
+    transceiver1.init();
+    transceiver2.init();
+
+    //the kernel turns on receive timestamping in the background the first time a socket asks for it, so datagrams
+    //go back and forth until one comes back stamped
+    char buf[32];
+    serial_library::SerialPacketInfo packets[4];
+    bool stamped = false;
+    for(int i = 0; i < 100 && !stamped; i++)
+    {
+        transceiver1.send("warmup", 6);
+        while(transceiver2.waitForData(0.1) && transceiver2.recvPackets(buf, sizeof(buf), packets, 4) > 0)
+        {
+            stamped = stamped || packets[0].timestamp != serial_library::Time();
+        }
+    }
+
+    ASSERT_TRUE(stamped);
+
+    //the timestamp is when the datagram arrived, not when it was picked up
+    serial_library::Time sent = serial_library::curtime();
+    transceiver1.send("stamped", 7);
+    usleep(50000);
+
+    ASSERT_EQ(transceiver2.recvPackets(buf, sizeof(buf), packets, 4), 1);
+    serial_library::Time picked = serial_library::curtime();
+    ASSERT_EQ("stamped", std::string(buf, packets[0].length));
+    ASSERT_TRUE(packets[0].timestamp >= sent);
+    ASSERT_TRUE(picked - packets[0].timestamp >= std::chrono::milliseconds(40));
+
+    transceiver1.deinit();
+    transceiver2.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestUDPServerTransceiver)
+{
+    auto server = std::make_shared<serial_library::LinuxUDPServerTransceiver>(9990, true);
+    ASSERT_TRUE(server->init());
+
+    //clients get ephemeral ports when they connect to the server
+    serial_library::LinuxUDPTransceiver
+        client1("localhost", 9990, 0.1, true, false),
+        client2("localhost", 9990, 0.1, true, false),
+        client3("localhost", 9990, 0.1, true, false);
+    
+    client1.init();
+    client2.init();
+    client3.init();
+
+    auto clientPort = [] (const serial_library::LinuxUDPTransceiver& client) {
+        sockaddr_in addr;
+        socklen_t addrLen = sizeof(addr);
+        getsockname(client.nativeHandle(), (sockaddr *) &addr, &addrLen);
+        return (int) ntohs(addr.sin_port);
+    };
+
+    serial_library::SerialTransceiver::UniquePtr
+        peer1 = server->peer("127.0.0.1", clientPort(client1)),
+        peer2 = server->peer("127.0.0.1", clientPort(client2)),
+        peer3;
+    
+    ASSERT_TRUE(peer1->init());
+    ASSERT_TRUE(peer2->init());
+
+    //the third client is unknown until it sends
+    server->setNewPeerCallback([&server, &peer3] (const std::string& address, int port) {
+        peer3 = server->peer(address, port);
+    });
+
+    client2.send("two", 3);
+    client1.send("one", 3);
+    client3.send("three", 5);
+    client1.send("one again", 9);
+    ASSERT_TRUE(peer1->waitForData(1));
+    while(server->receive(0.05) > 0);
+
+    ASSERT_EQ(server->numPeers(), 3);
+    ASSERT_TRUE(peer3);
+
+    char buf[32];
+    size_t s = peer1->recv(buf, sizeof(buf));
+    ASSERT_EQ("one", std::string(buf, s));
+    s = peer1->recv(buf, sizeof(buf));
+    ASSERT_EQ("one again", std::string(buf, s));
+    ASSERT_EQ(peer1->recv(buf, sizeof(buf)), 0);
+    s = peer2->recv(buf, sizeof(buf));
+    ASSERT_EQ("two", std::string(buf, s));
+    s = peer3->recv(buf, sizeof(buf));
+    ASSERT_EQ("three", std::string(buf, s));
+
+    //replies go out together and reach the right clients
+    peer3->send("reply3", 6);
+    peer1->send("reply1", 6);
+    ASSERT_EQ(server->flush(), 2);
+    s = client1.recv(buf, sizeof(buf));
+    ASSERT_EQ("reply1", std::string(buf, s));
+    s = client3.recv(buf, sizeof(buf));
+    ASSERT_EQ("reply3", std::string(buf, s));
+    ASSERT_EQ(client2.recv(buf, sizeof(buf)), 0);
+
+    peer1->deinit();
+    ASSERT_EQ(server->numPeers(), 2);
+    client1.deinit();
+    client2.deinit();
+    client3.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestUDPServerDropsTruncatedDatagrams)
+{
+    serial_library::LinuxUDPTransceiverOptions options;
+    options.maxDatagramSize = 16;
+    auto server = std::make_shared<serial_library::LinuxUDPServerTransceiver>(9991, true, options);
+    ASSERT_TRUE(server->init());
+
+    serial_library::LinuxUDPTransceiver client("localhost", 9991, 0.1, true, false);
+    client.init();
+
+    sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    getsockname(client.nativeHandle(), (sockaddr *) &addr, &addrLen);
+    serial_library::SerialTransceiver::UniquePtr peer = server->peer("127.0.0.1", ntohs(addr.sin_port));
+    ASSERT_TRUE(peer->init());
+
+    //a cut off frame would be garbage, so only the datagram that fits is delivered
+    client.send("this is longer than sixteen bytes", 33);
+    client.send("fits", 4);
+    ASSERT_TRUE(peer->waitForData(1));
+    while(server->receive(0.05) > 0);
+
+    char buf[64];
+    size_t s = peer->recv(buf, sizeof(buf));
+    ASSERT_EQ("fits", std::string(buf, s));
+    ASSERT_EQ(peer->recv(buf, sizeof(buf)), 0);
+    peer->deinit();
+    client.deinit();
+}
+
+TEST_F(LinuxTransceiverTest, TestUDPMulticastTransceiver)
+{
+    //everything over loopback
+    serial_library::LinuxUDPMulticastTransceiver
+        publisher("239.255.42.1", 9995, "127.0.0.1"),
+        subscriber1("239.255.42.1", 9995, "127.0.0.1"),
+        subscriber2("239.255.42.1", 9995, "127.0.0.1");
+    
+    ASSERT_TRUE(publisher.init());
+    ASSERT_TRUE(subscriber1.init());
+    ASSERT_TRUE(subscriber2.init());
+
+    //one send reaches every subscriber
+    publisher.send("telemetry", 9);
+    char buf[32];
+    ASSERT_TRUE(subscriber1.waitForData(1));
+    size_t s = subscriber1.recv(buf, sizeof(buf));
+    ASSERT_EQ("telemetry", std::string(buf, s));
+    ASSERT_TRUE(subscriber2.waitForData(1));
+    s = subscriber2.recv(buf, sizeof(buf));
+    ASSERT_EQ("telemetry", std::string(buf, s));
+
+    //a subscriber that left the group hears nothing more
+    ASSERT_TRUE(subscriber2.leaveGroup("239.255.42.1"));
+    publisher.send("more", 4);
+    ASSERT_TRUE(subscriber1.waitForData(1));
+    s = subscriber1.recv(buf, sizeof(buf));
+    ASSERT_EQ("more", std::string(buf, s));
+    ASSERT_FALSE(subscriber2.waitForData(0.1));
+
+    publisher.deinit();
+    subscriber1.deinit();
+    subscriber2.deinit();
+}
+
 #endif
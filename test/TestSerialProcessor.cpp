@@ -25,6 +25,44 @@ class TestTransceiver : public serial_library::SerialTransceiver
 };
 
 
+class RecordingTransceiver : public serial_library::SerialTransceiver
+{
+    public:
+    RecordingTransceiver(std::vector<std::string>& sends)
+     : sends(sends) { }
+
+    bool init(void) { return true; }
+    void send(const char *data, size_t numData) { sends.push_back(std::string(data, numData)); }
+    size_t recv(char *data, size_t numData) { return 0; }
+    void deinit(void) { }
+
+    private:
+    std::vector<std::string>& sends;
+};
+
+
+class PacedTransceiver : public serial_library::IntraProcessTransceiver
+{
+    public:
+    double secondsPerByte(void) const override { return 0.001; }
+};
+
+
+class BacklogTransceiver : public RecordingTransceiver
+{
+    public:
+    BacklogTransceiver(std::vector<std::string>& sends, size_t& backlog)
+     : RecordingTransceiver(sends),
+       backlog(backlog) { }
+
+    size_t outputBacklog(void) const override { return backlog; }
+    double secondsPerByte(void) const override { return 0.001; }
+
+    private:
+    size_t& backlog;
+};
+
+
 TEST_F(Type1SerialProcessorTest, TestBasicRecvWithManualSendType1)
 {
     const char msg[] = "AqweA";
@@ -43,6 +81,189 @@ TEST_F(Type1SerialProcessorTest, TestBasicRecvWithManualSendType1)
     ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("e", 1)));
 }
 
+TEST_F(Type1SerialProcessorTest, TestFramesStampedWithFirstByteArrival)
+{
+    //frames that arrive over several updates keep the time their first byte arrived
+    Time 
+        t1 = curtime(),
+        t2 = t1 + 10ms,
+        t3 = t1 + 20ms;
+
+    client->send("Aq", 2);
+    processor->update(t1);
+    ASSERT_FALSE(processor->hasDataForField(TYPE_1_FRAME_1_FIELD_1));
+    client->send("weAx", 4);
+    processor->update(t2);
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("e", 1)));
+    ASSERT_TRUE(processor->getFieldTimestamp(TYPE_1_FRAME_1_FIELD_3) == t1);
+
+    client->send("yz", 2);
+    processor->update(t3);
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("z", 1)));
+    ASSERT_TRUE(processor->getFieldTimestamp(TYPE_1_FRAME_1_FIELD_3) == t2);
+    ASSERT_TRUE(processor->getLastMsgRecvTime() == t2);
+}
+
+TEST_F(Type1SerialProcessorTest, TestFramesStampedFromByteTime)
+{
+    //one read completes at the last byte, and the bytes before it came one character time apart
+    auto paced = std::make_unique<PacedTransceiver>();
+    paced->getChannel()->setPartner(client->getChannel());
+    client->getChannel()->setPartner(paced->getChannel());
+    const char syncValue[1] = {'A'};
+    processor = std::make_shared<SerialProcessor>(std::move(paced), frameMap, TYPE_1_FRAME_1, syncValue, sizeof(syncValue));
+
+    Time 
+        t1 = curtime(),
+        t2 = t1 + 10ms;
+
+    client->send("AqweAx", 6);
+    processor->update(t1);
+    ASSERT_TRUE(processor->hasDataForField(TYPE_1_FRAME_1_FIELD_3));
+    ASSERT_TRUE(std::chrono::abs(processor->getFieldTimestamp(TYPE_1_FRAME_1_FIELD_3) - (t1 - 5ms)) < 1us);
+
+    //the second frame started in the first read, two bytes before it completed
+    client->send("yz", 2);
+    processor->update(t2);
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("z", 1)));
+    ASSERT_TRUE(std::chrono::abs(processor->getFieldTimestamp(TYPE_1_FRAME_1_FIELD_3) - (t1 - 1ms)) < 1us);
+}
+
+TEST_F(Type1SerialProcessorTest, TestReceiveThreadWakesWaiters)
+{
+    processor->start();
+    ASSERT_TRUE(processor->running());
+
+    std::thread sender([this] () {
+        std::this_thread::sleep_for(20ms);
+        client->send("Aqwe", 4);
+        std::this_thread::sleep_for(20ms);
+        client->send("Axyz", 4);
+    });
+
+    ASSERT_TRUE(processor->waitForField(TYPE_1_FRAME_1_FIELD_3, 1));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("e", 1)));
+    ASSERT_TRUE(processor->waitForFrame(TYPE_1_FRAME_1, 1));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("z", 1)));
+    sender.join();
+
+    //nothing else is coming
+    ASSERT_FALSE(processor->waitForAny(0.05));
+    processor->stop();
+    ASSERT_FALSE(processor->running());
+}
+
+TEST_F(Type1SerialProcessorTest, TestStopFromReceiveThread)
+{
+    //a listener on the receive thread stops it, which must not try to join itself
+    std::atomic<bool> stopped(false);
+    processor->addFrameListener(TYPE_1_FRAME_1, [this, &stopped] (const SerialValuesMap&) {
+        processor->stop();
+        stopped = true;
+        return true;
+    });
+
+    processor->start();
+    client->send("Aqwe", 4);
+    Time start = curtime();
+    while(!stopped && curtime() - start < 1s)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    ASSERT_TRUE(stopped);
+    ASSERT_FALSE(processor->running());
+
+    //and it can be started again
+    processor->start();
+    client->send("Axyz", 4);
+    ASSERT_TRUE(processor->waitForFrame(TYPE_1_FRAME_1, 1));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("z", 1)));
+    processor->stop();
+}
+
+TEST_F(Type1SerialProcessorTest, TestRestartWhileStoppedReceiveThreadFinishes)
+{
+    //another thread restarts the processor while the listener that stopped it is still running
+    std::atomic<bool> stopped(false);
+    processor->addFrameListener(TYPE_1_FRAME_1, [this, &stopped] (const SerialValuesMap&) {
+        processor->stop();
+        stopped = true;
+        std::this_thread::sleep_for(20ms);
+        return true;
+    });
+
+    processor->start();
+    client->send("Aqwe", 4);
+    Time start = curtime();
+    while(!stopped && curtime() - start < 1s)
+    {
+        std::this_thread::sleep_for(100us);
+    }
+
+    ASSERT_TRUE(stopped);
+    processor->start();
+    ASSERT_TRUE(processor->running());
+    client->send("Axyz", 4);
+    ASSERT_TRUE(processor->waitForFrame(TYPE_1_FRAME_1, 1));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("z", 1)));
+
+    //the old thread is gone, so this has only the new one to join
+    processor->stop();
+    ASSERT_FALSE(processor->running());
+}
+
+TEST_F(Type1SerialProcessorTest, TestSendAndAwaitResponse)
+{
+    processor->start();
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_1, 'a', curtime());
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_2, 'b', curtime());
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_3, 'c', curtime());
+
+    //the device acknowledges the command it got
+    std::thread device([this] () {
+        char buf[4];
+        if(client->waitForData(1) && client->recv(buf, sizeof(buf)) == sizeof(buf))
+        {
+            client->send("Aok!", 4);
+        }
+    });
+
+    ASSERT_TRUE(processor->sendAndAwait(TYPE_1_FRAME_1, TYPE_1_FRAME_1, 1));
+    device.join();
+    ASSERT_EQ(processor->getFieldValue<char>(TYPE_1_FRAME_1_FIELD_3), '!');
+
+    //nobody answers this time
+    ASSERT_FALSE(processor->sendAndAwait(TYPE_1_FRAME_1, TYPE_1_FRAME_1, 0.05));
+}
+
+TEST_F(Type1SerialProcessorTest, TestSendAsyncCorrelatesResponses)
+{
+    processor->start();
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_2, 'b', curtime());
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_3, 'c', curtime());
+
+    //several requests in flight, told apart by the first field
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_1, 'x', curtime());
+    std::future<SerialValuesMap> first = processor->sendAsync(TYPE_1_FRAME_1, TYPE_1_FRAME_1, 1, TYPE_1_FRAME_1_FIELD_1);
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_1, 'y', curtime());
+    std::future<SerialValuesMap> second = processor->sendAsync(TYPE_1_FRAME_1, TYPE_1_FRAME_1, 1, TYPE_1_FRAME_1_FIELD_1);
+    processor->setFieldValue<char>(TYPE_1_FRAME_1_FIELD_1, 'z', curtime());
+    std::future<SerialValuesMap> unanswered = processor->sendAsync(TYPE_1_FRAME_1, TYPE_1_FRAME_1, 0.05, TYPE_1_FRAME_1_FIELD_1);
+
+    //answered out of order
+    client->send("Ay.2", 4);
+    client->send("Ax.1", 4);
+
+    ASSERT_TRUE(second.wait_for(1s) == std::future_status::ready);
+    ASSERT_EQ(convertData<char>(second.get().at(TYPE_1_FRAME_1_FIELD_3)), '2');
+    ASSERT_TRUE(first.wait_for(1s) == std::future_status::ready);
+    ASSERT_EQ(convertData<char>(first.get().at(TYPE_1_FRAME_1_FIELD_3)), '1');
+
+    ASSERT_TRUE(unanswered.wait_for(1s) == std::future_status::ready);
+    ASSERT_THROW(unanswered.get(), NonFatalSerialLibraryException);
+}
+
 TEST_F(Type1SerialProcessorTest, TestBasicSendWithManualRecvType1)
 {
     //pack msg and send
@@ -505,3 +726,492 @@ TEST(GenericType2SerialProcessorTest, TestConstructorTransceiverInitFailed)
         serial_library::SerialProcessor proc(std::move(badTrans), frames, Type2SerialFrames1::TYPE_2_FRAME_1, "ab", 2),
         SerialLibraryException);
 }
+
+TEST_F(SerialProcessorTest, TestDeltaEncodedFrames)
+{
+    SerialFramesMap frames = {
+        {TYPE_2_FRAME_1, serial_library::assembleSerialFrame({
+            {FIELD_SYNC, 1},
+            {FIELD_FRAME, 1},
+            {TYPE_2_FIELD_1, 4},
+            {TYPE_2_FIELD_2, 4},
+            {TYPE_2_FIELD_3, 4}
+        })}
+    };
+
+    const char syncValue[1] = {'A'};
+    serial_library::SerialProcessor sender(
+        std::move(transceiver),
+        frames,
+        TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+    
+    //second link to feed the bytes captured from the sender into the receiver
+    std::unique_ptr<serial_library::IntraProcessTransceiver>
+        rxEnd = std::make_unique<serial_library::IntraProcessTransceiver>(),
+        txEnd = std::make_unique<serial_library::IntraProcessTransceiver>();
+    
+    rxEnd->getChannel()->setPartner(txEnd->getChannel());
+    txEnd->getChannel()->setPartner(rxEnd->getChannel());
+
+    serial_library::SerialProcessor receiver(
+        std::move(rxEnd),
+        frames,
+        TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    sender.setDeltaEncoding(TYPE_2_FRAME_1, 2);
+    receiver.setDeltaEncoding(TYPE_2_FRAME_1, 2);
+
+    //listeners get the whole frame, not just the fields a delta frame carries
+    SerialValuesMap heard;
+    receiver.addFrameListener(TYPE_2_FRAME_1, [&heard] (const SerialValuesMap& values) {
+        heard = values;
+        return false;
+    });
+    
+    Time now = curtime();
+    sender.setFieldValue<uint32_t>(TYPE_2_FIELD_1, 1, now);
+    sender.setFieldValue<uint32_t>(TYPE_2_FIELD_2, 2, now);
+    sender.setFieldValue<uint32_t>(TYPE_2_FIELD_3, 3, now);
+
+    //first send is a keyframe
+    char buf[64];
+    sender.send(TYPE_2_FRAME_1);
+    size_t recvd = client->recv(buf, sizeof(buf));
+    ASSERT_EQ(recvd, 14);
+    txEnd->send(buf, recvd);
+    receiver.update(now);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_1), 1);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_2), 2);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_3), 3);
+
+    //only the changed field is sent: sync, frame, bitmap, and four bytes of field 2
+    Time later = curtime();
+    sender.setFieldValue<uint32_t>(TYPE_2_FIELD_2, 0x12345678, later);
+    sender.send(TYPE_2_FRAME_1);
+    recvd = client->recv(buf, sizeof(buf));
+    ASSERT_EQ(recvd, 7);
+    ASSERT_EQ((uint8_t) buf[1], TYPE_2_FRAME_1 | DELTA_FRAME_FLAG);
+    txEnd->send(buf, recvd);
+    receiver.update(later);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_1), 1);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_2), 0x12345678);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_3), 3);
+    ASSERT_EQ(receiver.getFieldTimestamp(TYPE_2_FIELD_1), now);
+    ASSERT_EQ(receiver.getFieldTimestamp(TYPE_2_FIELD_2), later);
+    ASSERT_EQ(receiver.getFieldValue<SerialFrameId>(FIELD_FRAME), TYPE_2_FRAME_1);
+    ASSERT_EQ(heard.size(), 5);
+    ASSERT_EQ(serial_library::convertFromCString<uint32_t>(heard.at(TYPE_2_FIELD_1).data.data, heard.at(TYPE_2_FIELD_1).data.numData), 1);
+    ASSERT_EQ(serial_library::convertFromCString<uint32_t>(heard.at(TYPE_2_FIELD_2).data.data, heard.at(TYPE_2_FIELD_2).data.numData), 0x12345678);
+    ASSERT_EQ(serial_library::convertFromCString<uint32_t>(heard.at(TYPE_2_FIELD_3).data.data, heard.at(TYPE_2_FIELD_3).data.numData), 3);
+
+    //every second send is a keyframe
+    sender.send(TYPE_2_FRAME_1);
+    recvd = client->recv(buf, sizeof(buf));
+    ASSERT_EQ(recvd, 14);
+
+    //nothing changed since the keyframe, so only the header and bitmap go out
+    sender.send(TYPE_2_FRAME_1);
+    recvd = client->recv(buf, sizeof(buf));
+    ASSERT_EQ(recvd, 3);
+}
+
+TEST_F(SerialProcessorTest, TestDeltaFramesOnlyForDeltaEncodedFrames)
+{
+    SerialFramesMap frames = {
+        {TYPE_2_FRAME_1, serial_library::assembleSerialFrame({
+            {FIELD_SYNC, 1},
+            {FIELD_FRAME, 1},
+            {TYPE_2_FIELD_1, 4},
+            {TYPE_2_FIELD_2, 4}
+        })}
+    };
+
+    const char syncValue[1] = {'A'};
+    std::vector<std::string> sends;
+    serial_library::SerialProcessor
+        sender(std::make_unique<RecordingTransceiver>(sends), frames, TYPE_2_FRAME_1, syncValue, sizeof(syncValue)),
+        receiver(std::move(transceiver), frames, TYPE_2_FRAME_1, syncValue, sizeof(syncValue));
+
+    sender.setDeltaEncoding(TYPE_2_FRAME_1, 10);
+    Time now = curtime();
+    sender.setFieldValue<uint32_t>(TYPE_2_FIELD_1, 1, now);
+    sender.setFieldValue<uint32_t>(TYPE_2_FIELD_2, 2, now);
+
+    //a send with no transceiver is dropped, so the next one is still the keyframe
+    serial_library::SerialTransceiver::UniquePtr recorder = std::make_unique<RecordingTransceiver>(sends);
+    sender.resetTransceiver();
+    sender.send(TYPE_2_FRAME_1);
+    sender.setTransceiver(recorder);
+    sender.send(TYPE_2_FRAME_1);
+    sender.setFieldValue<uint32_t>(TYPE_2_FIELD_2, 5, now);
+    sender.send(TYPE_2_FRAME_1);
+    ASSERT_EQ(sends.size(), 2);
+    ASSERT_EQ(sends[0].length(), 10);
+    ASSERT_EQ(sends[1].length(), 7);
+
+    //a receiver that never enabled delta encoding drops the delta frame instead of guessing at it
+    client->send(sends[0].c_str(), sends[0].length());
+    client->send(sends[1].c_str(), sends[1].length());
+    receiver.update(now);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_2), 2);
+
+    receiver.setDeltaEncoding(TYPE_2_FRAME_1, 10);
+    client->send(sends[1].c_str(), sends[1].length());
+    receiver.update(now);
+    ASSERT_EQ(receiver.getFieldValue<uint32_t>(TYPE_2_FIELD_2), 5);
+}
+
+TEST_F(Type2SerialProcessorTest, TestSendBatch)
+{
+    const char syncValue[1] = {'A'};
+    std::vector<std::string> sends;
+    serial_library::SerialProcessor senderProcessor(
+        std::make_unique<RecordingTransceiver>(sends),
+        TYPE_2_FRAME_MAP,
+        Type2SerialFrames1::TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    Time now = curtime();
+    senderProcessor.setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("1", 1), now);
+    senderProcessor.setField(TYPE_2_FIELD_2, serial_library::serialDataFromString("234", 3), now);
+    senderProcessor.setField(TYPE_2_FIELD_3, serial_library::serialDataFromString("5", 1), now);
+    senderProcessor.setField(TYPE_2_FIELD_4, serial_library::serialDataFromString("6", 1), now);
+    senderProcessor.setField(TYPE_2_FIELD_5, serial_library::serialDataFromString("78", 2), now);
+    senderProcessor.setField(TYPE_2_FIELD_6, serial_library::serialDataFromString("9a", 2), now);
+
+    //all three frames go out in one write
+    senderProcessor.sendBatch({ TYPE_2_FRAME_1, TYPE_2_FRAME_2, TYPE_2_FRAME_3 });
+    ASSERT_EQ(sends.size(), 1);
+    ASSERT_EQ(sends[0].length(), 21);
+
+    //the receiving processor unpacks every frame in the write
+    client->send(sends[0].c_str(), sends[0].length());
+    processor->update(now);
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_2_FIELD_1).data, serial_library::serialDataFromString("1", 1)));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_2_FIELD_2).data, serial_library::serialDataFromString("234", 3)));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_2_FIELD_4).data, serial_library::serialDataFromString("6", 1)));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_2_FIELD_5).data, serial_library::serialDataFromString("78", 2)));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_2_FIELD_6).data, serial_library::serialDataFromString("9a", 2)));
+    SerialDataStamped data = processor->getField(FIELD_FRAME);
+    ASSERT_EQ(serial_library::convertFromCString<int>(data.data.data, data.data.numData), TYPE_2_FRAME_3);
+
+    //single send still works the same way
+    senderProcessor.send(TYPE_2_FRAME_1);
+    ASSERT_EQ(sends.size(), 2);
+    ASSERT_EQ(sends[1], sends[0].substr(0, 7));
+
+    //a bad frame stops the whole batch before anything is encoded, so the delta frame is still due a keyframe
+    senderProcessor.setDeltaEncoding(TYPE_2_FRAME_1, 10);
+    ASSERT_THROW(senderProcessor.sendBatch({ TYPE_2_FRAME_1, 99 }), serial_library::NonFatalSerialLibraryException);
+    ASSERT_EQ(sends.size(), 2);
+    senderProcessor.send(TYPE_2_FRAME_1);
+    ASSERT_EQ(sends.size(), 3);
+    ASSERT_EQ(sends[2], sends[0].substr(0, 7));
+}
+
+TEST(SerialSendQueueTest, TestQueuedSendsCoalesceWithinBudget)
+{
+    const char syncValue[1] = {'A'};
+    std::vector<std::string> sends;
+    size_t backlog = 100;
+    serial_library::SerialProcessor senderProcessor(
+        std::make_unique<BacklogTransceiver>(sends, backlog),
+        TYPE_2_FRAME_MAP,
+        Type2SerialFrames1::TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    Time now = curtime();
+    senderProcessor.setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("1", 1), now);
+    senderProcessor.setField(TYPE_2_FIELD_2, serial_library::serialDataFromString("234", 3), now);
+    senderProcessor.setField(TYPE_2_FIELD_3, serial_library::serialDataFromString("5", 1), now);
+    senderProcessor.setField(TYPE_2_FIELD_4, serial_library::serialDataFromString("6", 1), now);
+    senderProcessor.setField(TYPE_2_FIELD_5, serial_library::serialDataFromString("78", 2), now);
+    senderProcessor.setField(TYPE_2_FIELD_6, serial_library::serialDataFromString("9a", 2), now);
+
+    //10 bytes at 1 ms a byte. the link is busy, so everything waits, and the second frame 1 folds into the first
+    senderProcessor.setOutputLatencyBudget(0.01);
+    senderProcessor.queueSend(TYPE_2_FRAME_1);
+    senderProcessor.queueSend(TYPE_2_FRAME_2, 5);
+    senderProcessor.setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("9", 1), now);
+    senderProcessor.queueSend(TYPE_2_FRAME_1);
+    ASSERT_EQ(senderProcessor.queuedSends(), 2);
+    ASSERT_TRUE(sends.empty());
+
+    //only one 7 byte frame fits, and the higher priority goes first
+    backlog = 0;
+    ASSERT_EQ(senderProcessor.flushSendQueue(), 1);
+    ASSERT_EQ(sends.size(), 1);
+    ASSERT_EQ(sends[0][1], (char) TYPE_2_FRAME_2);
+
+    backlog = 7;
+    ASSERT_EQ(senderProcessor.flushSendQueue(), 0);
+
+    //frame 1 goes out once, with the latest value
+    backlog = 0;
+    ASSERT_EQ(senderProcessor.flushSendQueue(), 1);
+    ASSERT_EQ(sends.size(), 2);
+    ASSERT_EQ(sends[1][0], '9');
+    ASSERT_EQ(senderProcessor.queuedSends(), 0);
+
+    //without a budget, queued frames go out right away
+    backlog = 100;
+    senderProcessor.setOutputLatencyBudget(-1);
+    senderProcessor.queueSend(TYPE_2_FRAME_3);
+    ASSERT_EQ(sends.size(), 3);
+    ASSERT_EQ(senderProcessor.queuedSends(), 0);
+}
+
+TEST(SerialFieldsTest, TestSetAndGetFieldsTogether)
+{
+    const char syncValue[1] = {'A'};
+    std::vector<std::string> sends;
+    serial_library::SerialProcessor senderProcessor(
+        std::make_unique<RecordingTransceiver>(sends),
+        TYPE_2_FRAME_MAP,
+        Type2SerialFrames1::TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    Time now = curtime();
+    senderProcessor.setFields({
+        { TYPE_2_FIELD_1, serial_library::serialDataFromValue<uint8_t>(1) },
+        { TYPE_2_FIELD_2, serial_library::serialDataFromString("aaa", 3) },
+        { TYPE_2_FIELD_3, serial_library::serialDataFromString("a", 1) }
+    }, now);
+
+    SerialValuesMap values;
+    ASSERT_FALSE(senderProcessor.getFields({ TYPE_2_FIELD_1, TYPE_2_FIELD_4 }, values));
+    ASSERT_EQ(values.size(), 1);
+    ASSERT_EQ(senderProcessor.getFieldValue<uint8_t>(TYPE_2_FIELD_1), 1);
+    ASSERT_TRUE(values.at(TYPE_2_FIELD_1).timestamp == now);
+
+    //frames and snapshots never mix fields from two setFields() calls
+    std::atomic<bool> done(false);
+    std::thread writer([&senderProcessor, &done] () {
+        for(int i = 0; !done; i++)
+        {
+            const char *c = (i % 2 ? "b" : "a");
+            senderProcessor.setFields({
+                { TYPE_2_FIELD_2, serial_library::serialDataFromString(std::string(3, *c).c_str(), 3) },
+                { TYPE_2_FIELD_3, serial_library::serialDataFromString(c, 1) }
+            }, curtime());
+        }
+    });
+
+    //the writer is joined before anything is asserted
+    bool
+        complete = true,
+        mixed = false;
+
+    for(int i = 0; i < 2000 && complete && !mixed; i++)
+    {
+        senderProcessor.send(TYPE_2_FRAME_1);
+        complete = senderProcessor.getFields({ TYPE_2_FIELD_2, TYPE_2_FIELD_3 }, values);
+        mixed = complete && values.at(TYPE_2_FIELD_2).data.data[0] != values.at(TYPE_2_FIELD_3).data.data[0];
+    }
+
+    done = true;
+    writer.join();
+    ASSERT_TRUE(complete);
+    ASSERT_FALSE(mixed);
+    for(const std::string& frame : sends)
+    {
+        ASSERT_EQ(frame[2], frame[6]);
+    }
+}
+
+
+TEST(SerialFieldsTest, TestChecksumCallbackCanReadFields)
+{
+    //the checksum is generated after the fields are released, so the callback may read them
+    serial_library::SerialProcessor *senderPtr = nullptr;
+    serial_library::SerialProcessorCallbacks callbacks;
+    callbacks.checksumGenerationFunc = [&senderPtr] (const char *msg, size_t len) {
+        return (Checksum) senderPtr->getFieldValue<uint8_t>(TYPE_2_FIELD_1);
+    };
+
+    const char syncValue[1] = {'A'};
+    std::vector<std::string> sends;
+    serial_library::SerialProcessor senderProcessor(
+        std::make_unique<RecordingTransceiver>(sends),
+        TYPE_2_FRAME_MAP,
+        Type2SerialFrames1::TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue),
+        false,
+        callbacks);
+
+    senderPtr = &senderProcessor;
+    senderProcessor.setFields({
+        { TYPE_2_FIELD_1, serial_library::serialDataFromValue<uint8_t>(7) },
+        { TYPE_2_FIELD_5, serial_library::serialDataFromString("78", 2) }
+    }, curtime());
+
+    senderProcessor.send(TYPE_2_CHKSM_FRAME);
+    senderProcessor.setDeltaEncoding(TYPE_2_CHKSM_FRAME, 10);
+    senderProcessor.send(TYPE_2_CHKSM_FRAME);
+    senderProcessor.send(TYPE_2_CHKSM_FRAME);
+    ASSERT_EQ(sends.size(), 3);
+    ASSERT_EQ(sends[0].substr(2, 2), std::string("\0\x07", 2));
+    ASSERT_EQ(sends[2].substr(sends[2].length() - 2), std::string("\0\x07", 2));
+}
+
+#if defined(USE_LINUX)
+
+TEST_F(Type2SerialProcessorTest, TestPacketMode)
+{
+    const char syncValue[1] = {'A'};
+    auto transceiver = std::make_unique<serial_library::LinuxSocketpairTransceiver>(AF_UNIX, SOCK_SEQPACKET);
+    ASSERT_TRUE(transceiver->init());
+    ASSERT_TRUE(transceiver->capabilities() & serial_library::TRANSCEIVER_CAP_MESSAGE_BOUNDARIES);
+    int childFd = transceiver->childFd();
+
+    std::vector<std::string> sends;
+    serial_library::SerialProcessor
+        receiver(std::move(transceiver), TYPE_2_FRAME_MAP, Type2SerialFrames1::TYPE_2_FRAME_1, syncValue, sizeof(syncValue)),
+        sender(std::make_unique<RecordingTransceiver>(sends), TYPE_2_FRAME_MAP, Type2SerialFrames1::TYPE_2_FRAME_1, syncValue, sizeof(syncValue));
+
+    receiver.setPacketMode(true);
+
+    //byte streams would lose frames split across reads
+    ASSERT_THROW(sender.setPacketMode(true), serial_library::SerialLibraryException);
+    sender.setPacketMode(false);
+
+    Time now = curtime();
+    sender.setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("1", 1), now);
+    sender.setField(TYPE_2_FIELD_2, serial_library::serialDataFromString("234", 3), now);
+    sender.setField(TYPE_2_FIELD_3, serial_library::serialDataFromString("5", 1), now);
+    sender.setField(TYPE_2_FIELD_4, serial_library::serialDataFromString("6", 1), now);
+    sender.setField(TYPE_2_FIELD_5, serial_library::serialDataFromString("78", 2), now);
+    sender.setField(TYPE_2_FIELD_6, serial_library::serialDataFromString("9a", 2), now);
+    sender.sendBatch({ TYPE_2_FRAME_1, TYPE_2_FRAME_2, TYPE_2_FRAME_3 });
+    sender.setField(TYPE_2_FIELD_2, serial_library::serialDataFromString("bcd", 3), now);
+    sender.send(TYPE_2_FRAME_1);
+    ASSERT_EQ(sends.size(), 2);
+
+    //one message holding three frames
+    ASSERT_EQ(write(childFd, sends[0].c_str(), sends[0].length()), (ssize_t) sends[0].length());
+    receiver.update(now);
+    ASSERT_TRUE(compareSerialData(receiver.getField(TYPE_2_FIELD_2).data, serial_library::serialDataFromString("234", 3)));
+    ASSERT_TRUE(compareSerialData(receiver.getField(TYPE_2_FIELD_6).data, serial_library::serialDataFromString("9a", 2)));
+    SerialDataStamped data = receiver.getField(FIELD_FRAME);
+    ASSERT_EQ(serial_library::convertFromCString<int>(data.data.data, data.data.numData), TYPE_2_FRAME_3);
+
+    //a message that does not start with a frame is dropped whole, even though a frame follows the junk
+    std::string junkThenFrame = "xy" + sends[1];
+    ASSERT_EQ(write(childFd, junkThenFrame.c_str(), junkThenFrame.length()), (ssize_t) junkThenFrame.length());
+    receiver.update(now);
+    ASSERT_TRUE(compareSerialData(receiver.getField(TYPE_2_FIELD_2).data, serial_library::serialDataFromString("234", 3)));
+
+    //frames followed by a partial frame are kept, and the rest is dropped
+    std::string frameThenPartial = sends[1] + sends[1].substr(0, 3);
+    ASSERT_EQ(write(childFd, frameThenPartial.c_str(), frameThenPartial.length()), (ssize_t) frameThenPartial.length());
+    receiver.update(now);
+    ASSERT_TRUE(compareSerialData(receiver.getField(TYPE_2_FIELD_2).data, serial_library::serialDataFromString("bcd", 3)));
+}
+
+class HungUpTransceiver : public serial_library::SerialTransceiver
+{
+    public:
+    HungUpTransceiver(std::atomic<int>& recvs)
+     : recvs(recvs) { }
+
+    bool init(void)
+    {
+        //the write end is closed, so the read end polls as hung up for good
+        int fds[2];
+        if(pipe(fds) < 0)
+        {
+            return false;
+        }
+
+        close(fds[1]);
+        fd = fds[0];
+        return true;
+    }
+
+    void send(const char *data, size_t numData) { }
+    size_t recv(char *data, size_t numData) { recvs++; return 0; }
+    void deinit(void) { close(fd); }
+    NativeHandle nativeHandle(void) const override { return fd; }
+
+    private:
+    std::atomic<int>& recvs;
+    int fd;
+};
+
+TEST_F(Type1SerialProcessorTest, TestReceiveThreadBacksOffOnHangup)
+{
+    std::atomic<int> recvs(0);
+    auto transceiver = std::make_unique<HungUpTransceiver>(recvs);
+    ASSERT_TRUE(transceiver->init());
+    const char syncValue[1] = {'A'};
+    processor = std::make_shared<SerialProcessor>(std::move(transceiver), frameMap, TYPE_1_FRAME_1, syncValue, sizeof(syncValue));
+
+    //updated at the receive thread's wait rate rather than back to back
+    processor->start();
+    std::this_thread::sleep_for(100ms);
+    processor->stop();
+    ASSERT_GT(recvs, 0);
+    ASSERT_LT(recvs, 50);
+}
+
+static double processCpuSeconds(void)
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+TEST_F(Type1SerialProcessorTest, TestReceiveThreadOnUDPPeer)
+{
+    //a peer has no handle, and only gets datagrams when its waitForData() reads the server's socket
+    auto server = std::make_shared<serial_library::LinuxUDPServerTransceiver>(9992, true);
+    ASSERT_TRUE(server->init());
+    serial_library::LinuxUDPTransceiver device("localhost", 9992, 0.1, true, false);
+    device.init();
+
+    sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    getsockname(device.nativeHandle(), (sockaddr *) &addr, &addrLen);
+    const char syncValue[1] = {'A'};
+    processor = std::make_shared<SerialProcessor>(server->peer("127.0.0.1", ntohs(addr.sin_port)), frameMap, TYPE_1_FRAME_1, syncValue, sizeof(syncValue));
+    processor->start();
+
+    //idle without spinning
+    double cpuStart = processCpuSeconds();
+    std::this_thread::sleep_for(200ms);
+    ASSERT_LT(processCpuSeconds() - cpuStart, 0.1);
+
+    device.send("Aqwe", 4);
+    ASSERT_TRUE(processor->waitForFrame(TYPE_1_FRAME_1, 1));
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_1_FRAME_1_FIELD_3).data, serial_library::serialDataFromString("e", 1)));
+    processor->stop();
+    device.deinit();
+}
+
+TEST_F(Type1SerialProcessorTest, TestReceiveThreadOnDisconnectedTCPClient)
+{
+    //nobody listens, so the client keeps retrying on its reconnect interval
+    const char syncValue[1] = {'A'};
+    processor = std::make_shared<SerialProcessor>(
+        std::make_unique<serial_library::LinuxTCPTransceiver>("127.0.0.1", 9993, false, 0.1),
+        frameMap,
+        TYPE_1_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    processor->start();
+    double cpuStart = processCpuSeconds();
+    std::this_thread::sleep_for(300ms);
+    ASSERT_LT(processCpuSeconds() - cpuStart, 0.1);
+    processor->stop();
+}
+
+#endif
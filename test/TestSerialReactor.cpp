@@ -0,0 +1,142 @@
+#include "serial_library/serial_library.hpp"
+#include "serial_library/testing.hpp"
+#include <thread>
+
+#if defined(USE_LINUX)
+
+using namespace serial_library;
+
+using namespace std::chrono_literals;
+
+TEST_F(Type2SerialProcessorTest, TestReactorUpdatesOnReadiness)
+{
+    const char syncValue[1] = {'A'};
+    auto senderProcessor = std::make_shared<serial_library::SerialProcessor>(
+        std::move(client),
+        TYPE_2_FRAME_MAP,
+        Type2SerialFrames1::TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    SerialReactor reactor;
+    reactor.addProcessor(processor);
+    reactor.addProcessor(senderProcessor);
+
+    //nothing to do yet
+    ASSERT_EQ(reactor.spinOnce(0.01), 0);
+
+    Time now = curtime();
+    senderProcessor->setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("1", 1), now);
+    senderProcessor->setField(TYPE_2_FIELD_2, serial_library::serialDataFromString("234", 3), now);
+    senderProcessor->setField(TYPE_2_FIELD_3, serial_library::serialDataFromString("5", 1), now);
+    senderProcessor->send(TYPE_2_FRAME_1);
+
+    //only the receiving processor is ready
+    ASSERT_EQ(reactor.spinOnce(0.1), 1);
+    ASSERT_TRUE(compareSerialData(processor->getField(TYPE_2_FIELD_2).data, serial_library::serialDataFromString("234", 3)));
+    ASSERT_GE(processor->getFieldTimestamp(TYPE_2_FIELD_2), now);
+    ASSERT_EQ(reactor.spinOnce(0), 0);
+
+    //removed processors are no longer updated
+    reactor.removeProcessor(processor);
+    senderProcessor->send(TYPE_2_FRAME_1);
+    ASSERT_EQ(reactor.spinOnce(0.01), 0);
+}
+
+
+TEST_F(Type2SerialProcessorTest, TestReactorFollowsTCPReconnects)
+{
+    //a server can be added before any client connects, and keeps being updated across clients
+    const char syncValue[1] = {'A'};
+    auto receiver = std::make_shared<SerialProcessor>(
+        std::make_unique<LinuxTCPTransceiver>("127.0.0.1", 9998, true, 0.1, true),
+        TYPE_2_FRAME_MAP,
+        Type2SerialFrames1::TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    SerialReactor reactor;
+    reactor.addProcessor(receiver);
+    ASSERT_EQ(reactor.spinOnce(0.01), 0);
+
+    const char *values[2] = { "234", "567" };
+    for(const char *value : values)
+    {
+        SerialProcessor sender(
+            std::make_unique<LinuxTCPTransceiver>("127.0.0.1", 9998, false, 0.1),
+            TYPE_2_FRAME_MAP,
+            Type2SerialFrames1::TYPE_2_FRAME_1,
+            syncValue,
+            sizeof(syncValue));
+
+        Time now = curtime();
+        sender.setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("1", 1), now);
+        sender.setField(TYPE_2_FIELD_2, serial_library::serialDataFromString(value, 3), now);
+        sender.setField(TYPE_2_FIELD_3, serial_library::serialDataFromString("5", 1), now);
+        sender.send(TYPE_2_FRAME_1);
+
+        Time start = curtime();
+        while(!compareSerialData(receiver->getField(TYPE_2_FIELD_2).data, serial_library::serialDataFromString(value, 3)) && curtime() - start < 2s)
+        {
+            reactor.spinOnce(0.1);
+        }
+
+        ASSERT_TRUE(compareSerialData(receiver->getField(TYPE_2_FIELD_2).data, serial_library::serialDataFromString(value, 3)));
+    }
+}
+
+
+TEST(SerialReactorTest, TestReactorTimers)
+{
+    SerialReactor reactor;
+    int
+        fastCount = 0,
+        slowCount = 0;
+
+    SerialReactor::TimerId fast = reactor.addTimer(0.01, [&fastCount] (const Time&) { fastCount++; });
+    reactor.addTimer(0.025, [&slowCount] (const Time&) { slowCount++; });
+
+    std::thread stopper([&reactor] () {
+        std::this_thread::sleep_for(105ms);
+        reactor.stop();
+    });
+
+    reactor.spin();
+    stopper.join();
+
+    ASSERT_NEAR(fastCount, 10, 2);
+    ASSERT_NEAR(slowCount, 4, 1);
+
+    //removed timers stop firing
+    reactor.removeTimer(fast);
+    fastCount = 0;
+    Time start = curtime();
+    while(curtime() - start < 50ms)
+    {
+        reactor.spinOnce(0.05);
+    }
+
+    ASSERT_EQ(fastCount, 0);
+}
+
+
+TEST(SerialReactorTest, TestReactorStopBeforeSpin)
+{
+    //a stop that comes before spin() still ends it
+    SerialReactor reactor;
+    reactor.stop();
+    std::thread spinner([&reactor] () { reactor.spin(); });
+    spinner.join();
+}
+
+
+TEST(SerialReactorTest, TestReactorSubMillisecondTimeout)
+{
+    //sub-millisecond timeouts wait rather than returning right away
+    SerialReactor reactor;
+    Time start = curtime();
+    ASSERT_EQ(reactor.spinOnce(0.0005), 0);
+    ASSERT_GE(curtime() - start, 400us);
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include "serial_library/serial_library.hpp"
+#include "serial_library/testing.hpp"
+
+using namespace serial_library;
+
+using namespace std::chrono_literals;
+
+class WriteCountingTransceiver : public serial_library::SerialTransceiver
+{
+    public:
+    WriteCountingTransceiver(std::vector<size_t>& writes)
+     : writes(writes) { }
+
+    bool init(void) { return true; }
+    void send(const char *data, size_t numData) { writes.push_back(numData); }
+    size_t recv(char *data, size_t numData) { return 0; }
+    void deinit(void) { }
+
+    private:
+    std::vector<size_t>& writes;
+};
+
+
+static SerialProcessor::SharedPtr makeSchedulerProcessor(std::vector<size_t>& writes)
+{
+    const char syncValue[1] = {'A'};
+    auto processor = std::make_shared<SerialProcessor>(
+        std::make_unique<WriteCountingTransceiver>(writes),
+        TYPE_2_FRAME_MAP,
+        TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    Time now = curtime();
+    processor->setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("1", 1), now);
+    processor->setField(TYPE_2_FIELD_2, serial_library::serialDataFromString("234", 3), now);
+    processor->setField(TYPE_2_FIELD_3, serial_library::serialDataFromString("5", 1), now);
+    processor->setField(TYPE_2_FIELD_4, serial_library::serialDataFromString("6", 1), now);
+    return processor;
+}
+
+
+TEST(SerialSchedulerTest, TestSchedulerBatchesAndCountsMisses)
+{
+    std::vector<size_t> writes;
+    SerialProcessor::SharedPtr processor = makeSchedulerProcessor(writes);
+    SerialScheduler scheduler;
+    Time origin = scheduler.origin();
+
+    SerialScheduler::EntryId 
+        fast = scheduler.add(processor, TYPE_2_FRAME_1, 0.01),
+        slow = scheduler.add(processor, TYPE_2_FRAME_2, 0.02, 0, 1);
+
+    //nothing before the first deadline
+    ASSERT_EQ(scheduler.runDue(origin + 9ms), 0);
+    ASSERT_EQ(scheduler.runDue(origin + 10ms), 1);
+
+    //both due at 20 ms, so both go out in one write
+    writes.clear();
+    ASSERT_EQ(scheduler.runDue(origin + 20ms), 2);
+    ASSERT_EQ(writes.size(), 1);
+    ASSERT_EQ(writes[0], 14);
+
+    //the fast frame is 35 ms late for 30 ms and skips 40, 50 and 60. the slow one is 25 ms late for 40 and skips 60
+    ASSERT_EQ(scheduler.runDue(origin + 65ms), 2);
+    ASSERT_EQ(scheduler.stats(fast).missedDeadlines, 3);
+    ASSERT_EQ(scheduler.stats(slow).missedDeadlines, 1);
+    ASSERT_NEAR(scheduler.stats(fast).maxLatenessSeconds, 0.035, 1e-6);
+    ASSERT_EQ(scheduler.stats().sends, 5);
+
+    //deadlines stay on the grid
+    ASSERT_EQ(scheduler.runDue(origin + 69ms), 0);
+    ASSERT_EQ(scheduler.runDue(origin + 70ms), 1);
+
+    scheduler.remove(fast);
+    ASSERT_EQ(scheduler.runDue(origin + 80ms), 1);
+}
+
+
+TEST(SerialSchedulerTest, TestSchedulerCascadesFarDeadlines)
+{
+    std::vector<size_t> writes;
+    SerialProcessor::SharedPtr processor = makeSchedulerProcessor(writes);
+    SerialScheduler scheduler;
+    Time origin = scheduler.origin();
+
+    //far out entries must come down the wheel on time and count lateness from their own deadline
+    SerialScheduler::EntryId entry = scheduler.add(processor, TYPE_2_FRAME_2, 100);
+    ASSERT_EQ(scheduler.runDue(origin + 99999ms), 0);
+    ASSERT_EQ(scheduler.runDue(origin + 100002ms), 1);
+
+    SchedulerStats stats = scheduler.stats(entry);
+    ASSERT_EQ(stats.missedDeadlines, 0);
+    ASSERT_NEAR(stats.maxLatenessSeconds, 0.002, 1e-6);
+}
+
+
+class CallbackTransceiver : public serial_library::SerialTransceiver
+{
+    public:
+    CallbackTransceiver(const std::function<void(void)>& onSend)
+     : onSend(onSend) { }
+
+    bool init(void) { return true; }
+    void send(const char *data, size_t numData) { onSend(); }
+    size_t recv(char *data, size_t numData) { return 0; }
+    void deinit(void) { }
+
+    private:
+    std::function<void(void)> onSend;
+};
+
+
+TEST(SerialSchedulerTest, TestSchedulerSendsOutsideItsLock)
+{
+    SerialScheduler scheduler;
+    Time origin = scheduler.origin();
+    SerialScheduler::EntryId entry;
+    uint64_t sendsSeen = UINT64_MAX;
+
+    //the write calls back into the scheduler, which would deadlock if runDue still held its lock
+    const char syncValue[1] = {'A'};
+    auto processor = std::make_shared<SerialProcessor>(
+        std::make_unique<CallbackTransceiver>([&scheduler, &entry, &sendsSeen] () { sendsSeen = scheduler.stats(entry).sends; }),
+        TYPE_2_FRAME_MAP,
+        TYPE_2_FRAME_1,
+        syncValue,
+        sizeof(syncValue));
+
+    Time now = curtime();
+    processor->setField(TYPE_2_FIELD_1, serial_library::serialDataFromString("1", 1), now);
+    processor->setField(TYPE_2_FIELD_2, serial_library::serialDataFromString("234", 3), now);
+    processor->setField(TYPE_2_FIELD_3, serial_library::serialDataFromString("5", 1), now);
+
+    entry = scheduler.add(processor, TYPE_2_FRAME_1, 0.01);
+    ASSERT_EQ(scheduler.runDue(origin + 10ms), 1);
+    ASSERT_EQ(sendsSeen, 1);
+}
+
+
+TEST(SerialSchedulerTest, TestSchedulerStopBeforeSpin)
+{
+    SerialScheduler scheduler;
+    scheduler.stop();
+    std::thread spinner([&scheduler] () { scheduler.spin(); });
+    spinner.join();
+}
+
+
+TEST(SerialSchedulerTest, TestSchedulerSpins)
+{
+    std::vector<size_t> writes;
+    SerialProcessor::SharedPtr processor = makeSchedulerProcessor(writes);
+    SerialScheduler scheduler;
+    SerialScheduler::EntryId entry = scheduler.add(processor, TYPE_2_FRAME_1, 0.02);
+
+    //smoke test only. timing is covered through runDue() above, since a busy machine can hold this thread up
+    std::thread spinner([&scheduler] () { scheduler.spin(); });
+    std::this_thread::sleep_for(200ms);
+    scheduler.stop();
+    spinner.join();
+
+    SchedulerStats stats = scheduler.stats(entry);
+    ASSERT_GT(stats.sends, 0);
+    ASSERT_LE(stats.sends, 11);
+    ASSERT_EQ(writes.size(), stats.sends);
+}
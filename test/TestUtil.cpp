@@ -3,6 +3,8 @@
 
 using namespace serial_library;
 
+using namespace std::chrono_literals;
+
 TEST(UtilTest, testMemstr)
 {
     const char
@@ -312,3 +314,54 @@ TEST(UtilTest, testNormalizeSerialFrame)
 
     ASSERT_EQ(normalizedSyncEnd, expectedSyncEnd);
 }
+
+
+TEST(UtilTest, testDeltaFrameLayout)
+{
+    // TYPE_2_FIELD_5, FIELD_FRAME, FIELD_CHECKSUM, FIELD_CHECKSUM, FIELD_SYNC, TYPE_2_FIELD_1, TYPE_2_FIELD_5
+    SerialFrame frame = TYPE_2_FRAME_MAP.at(TYPE_2_CHKSM_FRAME);
+    ASSERT_EQ(serial_library::deltaFrameHeaderLength(frame), 5);
+
+    vector<SerialFieldId> expectedFields = { TYPE_2_FIELD_5, TYPE_2_FIELD_1 };
+    ASSERT_EQ(serial_library::deltaFrameFields(frame), expectedFields);
+
+    SerialFrame frameSyncBeginning = {
+        FIELD_SYNC,
+        FIELD_FRAME,
+        TYPE_1_FRAME_1_FIELD_2,
+        TYPE_1_FRAME_1_FIELD_1,
+        TYPE_1_FRAME_1_FIELD_2
+    };
+
+    ASSERT_EQ(serial_library::deltaFrameHeaderLength(frameSyncBeginning), 2);
+
+    expectedFields = { TYPE_1_FRAME_1_FIELD_2, TYPE_1_FRAME_1_FIELD_1 };
+    ASSERT_EQ(serial_library::deltaFrameFields(frameSyncBeginning), expectedFields);
+}
+
+
+TEST(UtilTest, testTscClock)
+{
+    //the counter shares steady_clock's timeline and never goes backwards
+    auto steadyBefore = std::chrono::steady_clock::now();
+    TscClock::time_point 
+        first = TscClock::now(),
+        second = TscClock::now();
+    
+    auto steadyAfter = std::chrono::steady_clock::now();
+    ASSERT_TRUE(second >= first);
+    ASSERT_TRUE(convertTime<std::chrono::steady_clock>(first) > steadyBefore - 1ms);
+    ASSERT_TRUE(convertTime<std::chrono::steady_clock>(second) < steadyAfter + 1ms);
+}
+
+
+TEST(UtilTest, testConvertTime)
+{
+    //wall clock times survive a round trip through Time
+    auto wall = std::chrono::system_clock::now() - 5s;
+    auto roundTrip = toSystemTime(fromSystemTime(wall));
+    ASSERT_TRUE(std::chrono::abs(roundTrip - wall) < 1ms);
+
+    auto steady = convertTime<std::chrono::steady_clock>(std::chrono::system_clock::now());
+    ASSERT_TRUE(std::chrono::abs(steady - std::chrono::steady_clock::now()) < 1ms);
+}